@@ -0,0 +1,13 @@
+#!/usr/bin/env sh
+
+set -e
+
+# Build TagLib from the submodule as a static library, for the taglib_native build tag
+cmake -S taglib -B build/native \
+    -DCMAKE_BUILD_TYPE=Release \
+    -DCMAKE_POSITION_INDEPENDENT_CODE=ON \
+    -DBUILD_SHARED_LIBS=OFF \
+    -DBUILD_TESTING=OFF \
+    -DBUILD_BINDINGS=OFF \
+    -DWITH_ZLIB=OFF
+cmake --build build/native --target tag
@@ -17,3 +17,10 @@ cmake --build build --target taglib
 mv build/taglib.wasm .
 
 wasm-opt --strip -c -O3 taglib.wasm -o taglib.wasm
+
+# SIMD variant, used through binarySIMDPath
+cmake -DWASI_SDK_PREFIX="$wasi_loc" -DCMAKE_TOOLCHAIN_FILE="$wasi_loc/share/cmake/wasi-sdk.cmake" -DTAGLIB_SIMD=ON -B build/simd .
+cmake --build build/simd --target taglib
+mv build/simd/taglib_simd.wasm .
+
+wasm-opt --strip -c -O3 taglib_simd.wasm -o taglib_simd.wasm
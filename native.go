@@ -0,0 +1,216 @@
+//go:build taglib_native
+
+package taglib
+
+// The native backend links taglib.cpp and TagLib into the binary through cgo, instead of
+// running the Wasm module. It has the same exports, so everything above the instance
+// interface is shared. Build TagLib from the submodule first, see the README.
+
+/*
+#cgo CXXFLAGS: -std=c++17 -O2
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib -I${SRCDIR}/taglib/taglib/toolkit
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/mpeg -I${SRCDIR}/taglib/taglib/mpeg/id3v1
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/mpeg/id3v2 -I${SRCDIR}/taglib/taglib/mpeg/id3v2/frames
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/ogg -I${SRCDIR}/taglib/taglib/ogg/flac
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/flac -I${SRCDIR}/taglib/taglib/mp4
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/riff -I${SRCDIR}/taglib/taglib/riff/aiff
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/riff/wav -I${SRCDIR}/taglib/taglib/ape
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/asf -I${SRCDIR}/taglib/taglib/wavpack
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/dsf -I${SRCDIR}/taglib/taglib/matroska
+#cgo CXXFLAGS: -I${SRCDIR}/taglib/taglib/matroska/ebml -I${SRCDIR}/build/native
+#cgo LDFLAGS: -L${SRCDIR}/build/native/taglib -ltag -lstdc++
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct taglib_native_instance taglib_native_instance;
+
+char *taglib_native_region_base(void);
+uint32_t taglib_native_region_size(void);
+size_t taglib_native_export_count(void);
+const char *taglib_native_export_name(size_t index);
+taglib_native_instance *taglib_native_new(int readOnly);
+void taglib_native_free(taglib_native_instance *instance);
+int taglib_native_call(taglib_native_instance *instance, size_t index, const uint64_t *params,
+                       size_t count, uint64_t *result);
+*/
+import "C"
+
+import (
+	"context"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"sync"
+	"unsafe"
+)
+
+// nativeExports maps export names to their index in the native export table
+var nativeExports = sync.OnceValue(func() map[string]C.size_t {
+	exports := map[string]C.size_t{}
+	for i := C.size_t(0); i < C.taglib_native_export_count(); i++ {
+		exports[C.GoString(C.taglib_native_export_name(i))] = i
+	}
+	return exports
+})
+
+// nativeRegion is the reserved region that arguments and results are passed through
+var nativeRegion = sync.OnceValue(func() unsafe.Pointer {
+	return unsafe.Pointer(C.taglib_native_region_base())
+})
+
+// instanceMemory is false as instances share the region, so its size isn't any one's
+// and WithRecyclePages doesn't apply. Neither does WithMemoryLimitPages.
+const instanceMemory = false
+
+// There's nothing to compile, so the cache in dir isn't used.
+func precompile(dir string) error { return nil }
+
+// nativeInstance holds the state of one instance of taglib.cpp. Native code reaches the
+// whole filesystem and ignores root. A readOnly instance fails every save of a file opened
+// by path, rather than relying on a mount to keep TagLib from writing. Calls can't be
+// stopped once they're running, so a context is only checked before each one.
+type nativeInstance struct {
+	p *C.taglib_native_instance
+}
+
+func newInstance(root string, readOnly bool, _ *leaseFS) (instance, error) {
+	if nativeRegion() == nil {
+		return nil, errors.New("reserve native memory region")
+	}
+	var ro C.int
+	if readOnly {
+		ro = 1
+	}
+	return nativeInstance{C.taglib_native_new(ro)}, nil
+}
+
+func (i nativeInstance) memory() memory { return nativeMemory{} }
+
+func (i nativeInstance) call(ctx context.Context, name string, params ...uint64) ([]uint64, error) {
+	if err := ctx.Err(); err != nil {
+		return nil, err
+	}
+	index, ok := nativeExports()[name]
+	if !ok {
+		return nil, fmt.Errorf("no export %q", name)
+	}
+	var paramsPtr *C.uint64_t
+	if len(params) > 0 {
+		paramsPtr = (*C.uint64_t)(unsafe.Pointer(&params[0]))
+	}
+
+	var result C.uint64_t
+	switch C.taglib_native_call(i.p, index, paramsPtr, C.size_t(len(params)), &result) {
+	case 0:
+		return nil, nil
+	case 1:
+		return []uint64{uint64(result)}, nil
+	default:
+		return nil, fmt.Errorf("native call %q failed", name)
+	}
+}
+
+func (i nativeInstance) close() error {
+	C.taglib_native_free(i.p)
+	return nil
+}
+
+// nativeMemory reads and writes the region. All instances share it, so Size is the most
+// of it that has been in use by all of them at once.
+type nativeMemory struct{}
+
+func (nativeMemory) view(offset, byteCount uint32) ([]byte, bool) {
+	if byteCount == 0 {
+		return []byte{}, true
+	}
+	if offset == 0 || uint64(offset)+uint64(byteCount) > 1<<32 {
+		return nil, false
+	}
+	return unsafe.Slice((*byte)(unsafe.Add(nativeRegion(), offset)), byteCount), true
+}
+
+func (m nativeMemory) Read(offset, byteCount uint32) ([]byte, bool) {
+	return m.view(offset, byteCount)
+}
+
+func (m nativeMemory) ReadUint32Le(offset uint32) (uint32, bool) {
+	b, ok := m.view(offset, 4)
+	if !ok {
+		return 0, false
+	}
+	return binary.LittleEndian.Uint32(b), true
+}
+
+func (m nativeMemory) ReadUint64Le(offset uint32) (uint64, bool) {
+	b, ok := m.view(offset, 8)
+	if !ok {
+		return 0, false
+	}
+	return binary.LittleEndian.Uint64(b), true
+}
+
+func (m nativeMemory) Write(offset uint32, v []byte) bool {
+	b, ok := m.view(offset, uint32(len(v)))
+	if !ok {
+		return false
+	}
+	copy(b, v)
+	return true
+}
+
+func (m nativeMemory) WriteUint32Le(offset, v uint32) bool {
+	b, ok := m.view(offset, 4)
+	if !ok {
+		return false
+	}
+	binary.LittleEndian.PutUint32(b, v)
+	return true
+}
+
+func (nativeMemory) Size() uint32 { return uint32(C.taglib_native_region_size()) }
+
+// Stream I/O imports of taglib.cpp. Buffers are TagLib's own memory, which Go may view
+// but not keep. The context of the call doesn't reach through C, so reads aren't cut short.
+
+//export go_stream_read
+func go_stream_read(streamId C.uint32_t, bufPtr unsafe.Pointer, length C.uint32_t) C.uint32_t {
+	return C.uint32_t(hostStreamRead(context.Background(), uint32(streamId), nativeBuf(bufPtr, length)))
+}
+
+//export go_stream_pread
+func go_stream_pread(streamId C.uint32_t, offset C.int64_t, bufPtr unsafe.Pointer, length C.uint32_t) C.uint32_t {
+	return C.uint32_t(hostStreamPread(context.Background(), uint32(streamId), int64(offset), nativeBuf(bufPtr, length)))
+}
+
+//export go_stream_pwrite
+func go_stream_pwrite(streamId C.uint32_t, offset C.int64_t, bufPtr unsafe.Pointer, length C.uint32_t) C.uint32_t {
+	return C.uint32_t(hostStreamPwrite(uint32(streamId), int64(offset), nativeBuf(bufPtr, length)))
+}
+
+//export go_stream_truncate
+func go_stream_truncate(streamId C.uint32_t, length C.int64_t) C.int32_t {
+	return C.int32_t(hostStreamTruncate(uint32(streamId), int64(length)))
+}
+
+//export go_stream_seek
+func go_stream_seek(streamId C.uint32_t, offset C.int64_t, whence C.int32_t) C.int32_t {
+	return C.int32_t(hostStreamSeek(uint32(streamId), int64(offset), int32(whence)))
+}
+
+//export go_stream_tell
+func go_stream_tell(streamId C.uint32_t) C.int64_t {
+	return C.int64_t(hostStreamTell(uint32(streamId)))
+}
+
+//export go_stream_length
+func go_stream_length(streamId C.uint32_t) C.int64_t {
+	return C.int64_t(hostStreamLength(uint32(streamId)))
+}
+
+func nativeBuf(ptr unsafe.Pointer, length C.uint32_t) []byte {
+	if ptr == nil || length == 0 {
+		return nil
+	}
+	return unsafe.Slice((*byte)(ptr), int(length))
+}
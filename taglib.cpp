@@ -1,11 +1,17 @@
 //go:build ignore
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <deque>
 #include <iostream>
-#include <map>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "fileref.h"
 #include "tiostream.h"
+#include "tfilestream.h"
 #include "tpropertymap.h"
 #include "mpeg/mpegfile.h"
 #include "mpeg/id3v1/id3v1tag.h"
@@ -15,12 +21,15 @@
 #include "mpeg/id3v2/frames/popularimeterframe.h"
 #include "mpeg/id3v2/frames/unsynchronizedlyricsframe.h"
 #include "mpeg/id3v2/frames/synchronizedlyricsframe.h"
+#include "mpeg/id3v2/frames/attachedpictureframe.h"
 #include "mpeg/mpegproperties.h"
 #include "mp4/mp4file.h"
 #include "mp4/mp4tag.h"
 #include "mp4/mp4item.h"
+#include "mp4/mp4coverart.h"
 #include "flac/flacfile.h"
 #include "flac/flacproperties.h"
+#include "flac/flacpicture.h"
 #include "mp4/mp4properties.h"
 #include "riff/aiff/aifffile.h"
 #include "riff/aiff/aiffproperties.h"
@@ -32,9 +41,11 @@
 #include "asf/asfproperties.h"
 #include "asf/asftag.h"
 #include "asf/asfattribute.h"
+#include "asf/asfpicture.h"
 #include "wavpack/wavpackfile.h"
 #include "wavpack/wavpackproperties.h"
 #include "ogg/oggfile.h"
+#include "ogg/xiphcomment.h"
 #include "ogg/vorbis/vorbisfile.h"
 #include "ogg/flac/oggflacfile.h"
 #include "ogg/opus/opusfile.h"
@@ -50,6 +61,47 @@
 #include "matroska/matroskatag.h"
 #include "matroska/matroskasimpletag.h"
 
+// ============================================================================
+// Build targets
+// ============================================================================
+
+// This file is built to Wasm by default. taglib_native.cpp includes it with TAGLIB_NATIVE
+// defined, to link the same exports into a Go binary through cgo, and defines these there.
+#ifndef TAGLIB_NATIVE
+#define TAGLIB_EXPORT(name) __attribute__((export_name(name)))
+#define TAGLIB_IMPORT(name) __attribute__((import_module("go_io"), import_name(name)))
+
+// A pointer stored in memory the host reads or writes, such as a field of a result or an
+// element of an argument array. It's 32 bits wide in both builds, so results have one layout.
+template <typename T> using guest_ptr = T *;
+
+// Tells the host that an allocation of size bytes failed, which means memory can't grow
+// any further. The host then fails the call with ErrMemoryLimit rather than a generic error.
+extern "C" TAGLIB_IMPORT("memory_exhausted") void go_memory_exhausted(uint32_t size);
+
+// Memory for the arena, which is everything the host reads or writes
+static void *boundary_alloc(size_t size) {
+  void *p = malloc(size);
+  if (!p && size > 0)
+    go_memory_exhausted(static_cast<uint32_t>(size));
+  return p;
+}
+static void boundary_free(void *p) { free(p); }
+
+// The module can't unwind, so when one of TagLib's allocations can't be met it traps after
+// telling the host, rather than throwing a std::bad_alloc that nothing would catch
+void *operator new(size_t size) {
+  if (void *p = malloc(size > 0 ? size : 1))
+    return p;
+  go_memory_exhausted(static_cast<uint32_t>(size));
+  __builtin_trap();
+}
+void operator delete(void *p) noexcept { free(p); }
+#endif
+
+// Null terminated array of strings from the host
+using guest_strings = guest_ptr<const char> *;
+
 // File format enum - must match Go's FileFormat
 enum FileFormat : uint8_t {
   FORMAT_UNKNOWN = 0,
@@ -77,47 +129,88 @@ enum FileFormat : uint8_t {
 // Host function imports (implemented in Go, called from WASM)
 // ============================================================================
 
+// Buffers are void * to match the prototypes cgo generates for the native backend's
+// //export functions, which take an unsafe.Pointer. In Wasm they're 32 bit offsets either way.
 extern "C" {
   // Read up to 'length' bytes from stream 'streamId' into buffer at 'bufPtr'.
-  // Returns number of bytes actually read.
-  __attribute__((import_module("go_io"), import_name("stream_read")))
-  uint32_t go_stream_read(uint32_t streamId, uint32_t bufPtr, uint32_t length);
+  // Returns number of bytes actually read, which is only short at the end of the stream or on error.
+  TAGLIB_IMPORT("stream_read")
+  uint32_t go_stream_read(uint32_t streamId, void *bufPtr, uint32_t length);
 
   // Seek to position in stream. whence: 0=Beginning, 1=Current, 2=End
   // Returns 0 on success, non-zero on error.
-  __attribute__((import_module("go_io"), import_name("stream_seek")))
+  TAGLIB_IMPORT("stream_seek")
   int32_t go_stream_seek(uint32_t streamId, int64_t offset, int32_t whence);
 
   // Returns current position in stream.
-  __attribute__((import_module("go_io"), import_name("stream_tell")))
+  TAGLIB_IMPORT("stream_tell")
   int64_t go_stream_tell(uint32_t streamId);
 
   // Returns total length of stream.
-  __attribute__((import_module("go_io"), import_name("stream_length")))
+  TAGLIB_IMPORT("stream_length")
   int64_t go_stream_length(uint32_t streamId);
+
+  // Read up to 'length' bytes at 'offset' of io.ReaderAt stream 'streamId' into buffer at
+  // 'bufPtr', without touching any stream position. Returns number of bytes actually read,
+  // which is only short at the end of the stream or on error.
+  TAGLIB_IMPORT("stream_pread")
+  uint32_t go_stream_pread(uint32_t streamId, int64_t offset, void *bufPtr, uint32_t length);
+
+  // Write 'length' bytes from buffer at 'bufPtr' at 'offset' of writable stream 'streamId'.
+  // Returns number of bytes actually written, which is only short on error.
+  TAGLIB_IMPORT("stream_pwrite")
+  uint32_t go_stream_pwrite(uint32_t streamId, int64_t offset, void *bufPtr, uint32_t length);
+
+  // Cut writable stream 'streamId' to 'length' bytes.
+  // Returns 0 on success, non-zero on error or if the stream can't be truncated.
+  TAGLIB_IMPORT("stream_truncate")
+  int32_t go_stream_truncate(uint32_t streamId, int64_t length);
 }
 
 // ============================================================================
 // GoIOStream - IOStream implementation backed by Go io.ReadSeeker
 // ============================================================================
 
+// Counters for the I/O a GoIOStream does. Layout must match Go's wasmStreamStats.
+struct StreamStats {
+  uint64_t hits;         // readBlock calls served entirely from cached blocks
+  uint64_t misses;       // readBlock calls that had to go to the host
+  uint64_t hostReads;    // go_stream_read calls
+  uint64_t hostBytes;    // bytes returned by go_stream_read
+  uint64_t hostWrites;   // go_stream_pwrite calls
+  uint64_t hostWritten;  // bytes written by go_stream_pwrite
+};
+
 class GoIOStream : public TagLib::IOStream {
 public:
-  static constexpr size_t BUFFER_SIZE = 32 * 1024; // 32KB - optimal for all formats
-
-  GoIOStream(uint32_t streamId, const char *filename = "")
+  // Blocks start small so that random probes (tail tags, footers, cues) only pull in what's
+  // around them, and double with every miss that continues where the last block ended.
+  static constexpr size_t MIN_BLOCK_SIZE = 8 * 1024;
+  static constexpr size_t MAX_BLOCK_SIZE = 256 * 1024;
+  // Enough for a head, a tail and a sequential run to stay cached at the same time
+  static constexpr size_t BLOCK_COUNT = 4;
+
+  // A non-negative length means the stream is an io.ReaderAt of that size, read with
+  // go_stream_pread. Otherwise it's an io.ReadSeeker, read with go_stream_seek and go_stream_read.
+  // Writable streams are written with go_stream_pwrite and go_stream_truncate.
+  GoIOStream(uint32_t streamId, const char *filename = "", int64_t length = -1, bool writable = false)
     : m_streamId(streamId)
-    , m_readOnly(true)
+    , m_readerAt(length >= 0)
+    , m_readOnly(!writable)
+    , m_writeFailed(false)
     , m_position(0)
-    , m_length(go_stream_length(streamId))
-    , m_buffer(nullptr)
-    , m_bufStart(-1)
-    , m_bufLen(0)
+    , m_length(length >= 0 ? length : go_stream_length(streamId))
+    , m_blocks()
+    , m_clock(0)
+    , m_blockSize(MIN_BLOCK_SIZE)
+    , m_lastMissEnd(-1)
+    , m_stats()
     , m_filename(filename ? filename : "")
   {}
 
   ~GoIOStream() {
-    if (m_buffer) free(m_buffer);
+    for (auto &b : m_blocks)
+      if (b.data) free(b.data);
   }
 
   TagLib::FileName name() const override {
@@ -135,31 +228,74 @@ public:
     TagLib::ByteVector result;
     result.resize(toRead);
     size_t totalRead = 0;
+    bool missed = false;
 
     while (totalRead < toRead) {
-      // Check if position is in buffer
-      if (m_bufLen > 0 && m_position >= m_bufStart &&
-          m_position < m_bufStart + static_cast<int64_t>(m_bufLen)) {
-        size_t bufOffset = static_cast<size_t>(m_position - m_bufStart);
-        size_t bufAvail = m_bufLen - bufOffset;
-        size_t toCopy = std::min(toRead - totalRead, bufAvail);
-        memcpy(result.data() + totalRead, m_buffer + bufOffset, toCopy);
+      // Check if position is in a cached block
+      if (Block *b = findBlock(m_position)) {
+        size_t bufOffset = static_cast<size_t>(m_position - b->start);
+        size_t toCopy = std::min(toRead - totalRead, b->len - bufOffset);
+        memcpy(result.data() + totalRead, b->data + bufOffset, toCopy);
+        b->lastUse = ++m_clock;
         m_position += toCopy;
         totalRead += toCopy;
         continue;
       }
 
-      // Buffer miss - refill
-      if (!refillBuffer()) break;
+      missed = true;
+      size_t remaining = toRead - totalRead;
+
+      // Large reads (picture data, audio frames) go straight into the result rather than
+      // evicting every cached block on their way through
+      if (remaining >= MAX_BLOCK_SIZE) {
+        size_t n = hostRead(m_position, result.data() + totalRead, remaining);
+        m_position += n;
+        totalRead += n;
+        break;
+      }
+
+      // Cache miss - fill a block
+      if (!fillBlock(remaining)) break;
     }
 
+    if (missed)
+      m_stats.misses++;
+    else
+      m_stats.hits++;
+
     if (totalRead < toRead) result.resize(totalRead);
     return result;
   }
 
-  void writeBlock(const TagLib::ByteVector &data) override {}
-  void insert(const TagLib::ByteVector &data, TagLib::offset_t start, size_t replace) override {}
-  void removeBlock(TagLib::offset_t start, size_t length) override {}
+  void writeBlock(const TagLib::ByteVector &data) override {
+    if (m_readOnly || data.isEmpty()) return;
+    size_t n = hostWrite(m_position, data.data(), data.size());
+    m_position += n;
+    m_length = std::max(m_length, m_position);
+  }
+
+  void insert(const TagLib::ByteVector &data, TagLib::offset_t start, size_t replace) override {
+    if (m_readOnly) return;
+    const auto size = static_cast<int64_t>(data.size());
+    if (size > static_cast<int64_t>(replace)) {
+      // Make room by moving whatever follows the replaced bytes, only once for the whole insert
+      int64_t delta = size - static_cast<int64_t>(replace);
+      if (!moveTail(start + static_cast<int64_t>(replace), delta)) return;
+      m_length += delta;
+    }
+    seek(start);
+    writeBlock(data);
+    if (size < static_cast<int64_t>(replace))
+      removeBlock(start + size, replace - data.size());
+  }
+
+  void removeBlock(TagLib::offset_t start, size_t length) override {
+    if (m_readOnly || length == 0) return;
+    const auto delta = static_cast<int64_t>(length);
+    if (!moveTail(start + delta, -delta)) return;
+    truncate(m_length - delta);
+  }
+
   bool readOnly() const override { return m_readOnly; }
   bool isOpen() const override { return true; }
 
@@ -178,54 +314,280 @@ public:
   void clear() override {}
   TagLib::offset_t tell() const override { return m_position; }
   TagLib::offset_t length() override { return m_length; }
-  void truncate(TagLib::offset_t length) override {}
+  void truncate(TagLib::offset_t length) override {
+    if (m_readOnly) return;
+    if (go_stream_truncate(m_streamId, length) != 0) {
+      m_writeFailed = true;
+      return;
+    }
+    m_length = length;
+    m_position = std::min(m_position, m_length);
+    invalidateFrom(length);
+  }
+
+  const StreamStats &stats() const { return m_stats; }
+
+  // Caps the reads asked of the host over the stream's life, 0 meaning no limit. Once the
+  // budget is spent, reads come back short, which TagLib takes for the end of the stream.
+  void setReadBudget(uint64_t bytes, uint32_t reads) {
+    m_budgetBytes = bytes;
+    m_budgetReads = reads;
+  }
+
+  // Whether a read was cut short by the budget, so what TagLib derived from it may be off
+  bool budgetExhausted() const { return m_budgetExhausted; }
+
+  // TagLib doesn't check writes, so failures are remembered for the save to report
+  bool writeFailed() const { return m_writeFailed; }
+  void clearWriteFailed() { m_writeFailed = false; }
 
 private:
-  bool refillBuffer() {
-    if (!m_buffer) {
-      m_buffer = static_cast<char *>(malloc(BUFFER_SIZE));
-      if (!m_buffer) return false;
+  struct Block {
+    int64_t start;
+    size_t len;
+    size_t cap;
+    char *data;
+    uint64_t lastUse;
+  };
+
+  Block *findBlock(int64_t pos) {
+    for (auto &b : m_blocks)
+      if (b.len > 0 && pos >= b.start && pos < b.start + static_cast<int64_t>(b.len))
+        return &b;
+    return nullptr;
+  }
+
+  // Reads up to length bytes at pos from the host into dst with a single call, returning how
+  // many were read. The host fills the whole buffer unless the stream ends first.
+  size_t hostRead(int64_t pos, char *dst, size_t length) {
+    if (m_budgetReads && m_stats.hostReads >= m_budgetReads) {
+      m_budgetExhausted = true;
+      return 0;
+    }
+    if (m_budgetBytes) {
+      const uint64_t left = m_budgetBytes - std::min(m_budgetBytes, m_stats.hostBytes);
+      if (length > left) {
+        m_budgetExhausted = true;
+        length = static_cast<size_t>(left);
+      }
+      if (length == 0)
+        return 0;
+    }
+
+    if (m_readerAt) {
+      uint32_t bytesRead = go_stream_pread(m_streamId, pos, dst, static_cast<uint32_t>(length));
+      m_stats.hostReads++;
+      m_stats.hostBytes += bytesRead;
+      return bytesRead;
     }
 
-    go_stream_seek(m_streamId, m_position, 0);
+    go_stream_seek(m_streamId, pos, 0);
 
-    size_t totalRead = 0;
-    while (totalRead < BUFFER_SIZE) {
-      uint32_t bytesRead = go_stream_read(m_streamId,
-          reinterpret_cast<uint32_t>(m_buffer + totalRead),
-          static_cast<uint32_t>(BUFFER_SIZE - totalRead));
-      if (bytesRead == 0) break;
-      totalRead += bytesRead;
+    uint32_t bytesRead = go_stream_read(m_streamId, dst, static_cast<uint32_t>(length));
+    m_stats.hostReads++;
+    m_stats.hostBytes += bytesRead;
+    return bytesRead;
+  }
+
+  // Writes length bytes from src at pos to the host with a single call, returning how many
+  // were written. Cached blocks covering the range are updated to match.
+  size_t hostWrite(int64_t pos, const char *src, size_t length) {
+    uint32_t written = go_stream_pwrite(m_streamId, pos, const_cast<char *>(src),
+                                        static_cast<uint32_t>(length));
+    m_stats.hostWrites++;
+    m_stats.hostWritten += written;
+    if (written < length)
+      m_writeFailed = true;
+
+    const int64_t end = pos + static_cast<int64_t>(written);
+    for (auto &b : m_blocks) {
+      const int64_t blockEnd = b.start + static_cast<int64_t>(b.len);
+      if (b.len == 0 || blockEnd <= pos || b.start >= end) continue;
+      const int64_t from = std::max(pos, b.start);
+      const int64_t to = std::min(end, blockEnd);
+      memcpy(b.data + (from - b.start), src + (from - pos), static_cast<size_t>(to - from));
+    }
+    return written;
+  }
+
+  // Moves everything from pos to the end of the stream by delta bytes, going from the end when
+  // moving forward so no byte is overwritten before it's been copied.
+  bool moveTail(int64_t pos, int64_t delta) {
+    if (pos >= m_length || delta == 0) return true;
+
+    std::vector<char> buf(static_cast<size_t>(std::min<int64_t>(MAX_BLOCK_SIZE, m_length - pos)));
+    int64_t remaining = m_length - pos;
+    while (remaining > 0) {
+      size_t n = static_cast<size_t>(std::min<int64_t>(buf.size(), remaining));
+      int64_t from = delta > 0 ? pos + remaining - static_cast<int64_t>(n) : m_length - remaining;
+      if (hostRead(from, buf.data(), n) != n || hostWrite(from + delta, buf.data(), n) != n) {
+        m_writeFailed = true;
+        break;
+      }
+      remaining -= static_cast<int64_t>(n);
+    }
+
+    invalidateFrom(std::min(pos, pos + delta));
+    return !m_writeFailed;
+  }
+
+  // Drops cached bytes at or after pos, which a move or truncate made stale
+  void invalidateFrom(int64_t pos) {
+    for (auto &b : m_blocks) {
+      if (b.len == 0 || b.start + static_cast<int64_t>(b.len) <= pos) continue;
+      b.len = b.start >= pos ? 0 : static_cast<size_t>(pos - b.start);
+    }
+    m_lastMissEnd = -1;
+  }
+
+  bool fillBlock(size_t wanted) {
+    // Grow the read-ahead while access is sequential, fall back to small blocks otherwise
+    if (m_position == m_lastMissEnd)
+      m_blockSize = std::min(m_blockSize * 2, MAX_BLOCK_SIZE);
+    else
+      m_blockSize = MIN_BLOCK_SIZE;
+
+    size_t size = std::max(m_blockSize, wanted);
+    size = std::min(size, static_cast<size_t>(m_length - m_position));
+
+    // Reuse the least recently used block
+    Block *victim = &m_blocks[0];
+    for (auto &b : m_blocks)
+      if (b.lastUse < victim->lastUse)
+        victim = &b;
+
+    if (victim->cap < size) {
+      char *data = static_cast<char *>(realloc(victim->data, size));
+      if (!data) return false;
+      victim->data = data;
+      victim->cap = size;
     }
 
+    victim->len = 0;
+    size_t totalRead = hostRead(m_position, victim->data, size);
     if (totalRead == 0) return false;
-    m_bufStart = m_position;
-    m_bufLen = totalRead;
+
+    victim->start = m_position;
+    victim->len = totalRead;
+    victim->lastUse = ++m_clock;
+    m_lastMissEnd = m_position + static_cast<int64_t>(totalRead);
     return true;
   }
 
   uint32_t m_streamId;
+  bool m_readerAt;
   bool m_readOnly;
+  bool m_writeFailed;
   int64_t m_position;
   int64_t m_length;
-  char *m_buffer;
-  int64_t m_bufStart;
-  size_t m_bufLen;
+  Block m_blocks[BLOCK_COUNT];
+  uint64_t m_clock;
+  size_t m_blockSize;
+  int64_t m_lastMissEnd;
+  StreamStats m_stats;
+  uint64_t m_budgetBytes = 0;
+  uint32_t m_budgetReads = 0;
+  bool m_budgetExhausted = false;
   std::string m_filename;
 };
 
-// Handle management
+// Handle management. The stream is declared first so it outlives the file reading it.
 struct FileHandle {
-  TagLib::FileRef *fileRef;
-  GoIOStream *stream;  // non-null if opened from stream
-  FileFormat format;
+  std::optional<GoIOStream> stream;  // set if opened from stream
+  TagLib::FileRef fileRef;
+  FileFormat format = FORMAT_UNKNOWN;
+  std::string filename;  // path the file was opened from, empty for streams
+  TagLib::AudioProperties::ReadStyle readStyle = TagLib::AudioProperties::Average;
+  bool audioProperties = true;  // false until audio properties are read, if opened without them
+
+  GoIOStream *goStream() { return stream ? &*stream : nullptr; }
+};
+
+// Open files, stored in slots that are reused once closed. A handle is the slot's index + 1 in
+// the low 16 bits, so it's never 0, and the slot's generation in the high 16 bits. Releasing a
+// slot bumps its generation, so a stale handle doesn't resolve to a file opened later in the
+// same slot. Slots are kept in a deque, which never moves them, as TagLib holds pointers to the
+// streams inside.
+class HandleTable {
+public:
+  static constexpr uint32_t INDEX_BITS = 16;
+  static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+  // Takes a free slot, returning its handle, or 0 if every slot is in use
+  uint32_t acquire() {
+    uint32_t index;
+    if (!m_free.empty()) {
+      index = m_free.back();
+      m_free.pop_back();
+    } else if (m_slots.size() < INDEX_MASK) {
+      index = static_cast<uint32_t>(m_slots.size());
+      m_slots.emplace_back();
+    } else {
+      return 0;
+    }
+    Slot &slot = m_slots[index];
+    slot.used = true;
+    return static_cast<uint32_t>(slot.generation) << INDEX_BITS | (index + 1);
+  }
+
+  FileHandle *get(uint32_t handle) {
+    Slot *slot = find(handle);
+    return slot ? &slot->file : nullptr;
+  }
+
+  // Closes the file in handle's slot, and frees the slot for reuse
+  void release(uint32_t handle) {
+    if (Slot *slot = find(handle))
+      release(*slot, (handle & INDEX_MASK) - 1);
+  }
+
+  void clear() {
+    for (size_t i = 0; i < m_slots.size(); i++)
+      if (m_slots[i].used)
+        release(m_slots[i], static_cast<uint32_t>(i));
+  }
+
+private:
+  struct Slot {
+    uint16_t generation = 0;
+    bool used = false;
+    FileHandle file;
+  };
+
+  Slot *find(uint32_t handle) {
+    uint32_t index = (handle & INDEX_MASK) - 1;
+    if (index >= m_slots.size())
+      return nullptr;
+    Slot &slot = m_slots[index];
+    if (!slot.used || slot.generation != handle >> INDEX_BITS)
+      return nullptr;
+    return &slot;
+  }
+
+  void release(Slot &slot, uint32_t index) {
+    FileHandle &h = slot.file;
+    h.fileRef = TagLib::FileRef();
+    h.stream.reset();
+    h.format = FORMAT_UNKNOWN;
+    h.filename.clear();
+    h.audioProperties = true;
+    slot.used = false;
+    slot.generation++;
+    m_free.push_back(index);
+  }
+
+  std::deque<Slot> m_slots;
+  std::vector<uint32_t> m_free;
 };
 
 // ============================================================================
-// Global handle map and utilities
+// Global handle table and utilities
 // ============================================================================
-static std::map<uint32_t, FileHandle> g_handles;
-static uint32_t g_nextHandle = 1;
+#ifdef TAGLIB_NATIVE
+#define g_handles (native_state<HandleTable>())
+#else
+static HandleTable g_handles;
+#endif
 
 static FileFormat detect_format(TagLib::File *file) {
   if (!file) return FORMAT_UNKNOWN;
@@ -250,15 +612,173 @@ static FileFormat detect_format(TagLib::File *file) {
   return FORMAT_UNKNOWN;
 }
 
+// Bump allocator for memory handed to the host, either as a call result or as an argument
+// buffer from the exported malloc. The host reads the results of a call before it makes the
+// next one, so whatever the next call allocates first, its first argument or else its own
+// results, frees the previous call's memory. A long-lived handle keeps a flat footprint
+// without a call of its own to reset the arena.
+class Arena {
+public:
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+  Arena() = default;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  ~Arena() {
+    for (auto &chunk : m_chunks)
+      boundary_free(chunk.data);
+  }
+
+  void *alloc(size_t size) {
+    size = (size + 7) & ~static_cast<size_t>(7);
+    if (m_chunks.empty() || m_offset + size > m_chunks.back().size) {
+      if (!grow(size))
+        return nullptr;
+    }
+
+    void *p = m_chunks.back().data + m_offset;
+    m_offset += size;
+    m_used += size;
+    m_peak = std::max(m_peak, m_used);
+    return p;
+  }
+
+  // Frees everything allocated since the last reset. The first chunk is kept so the common
+  // case doesn't go back to malloc, anything bigger that a large result needed is returned.
+  void reset() {
+    while (m_chunks.size() > 1 || (!m_chunks.empty() && m_chunks.back().size != CHUNK_SIZE)) {
+      m_reserved -= m_chunks.back().size;
+      boundary_free(m_chunks.back().data);
+      m_chunks.pop_back();
+    }
+    m_offset = 0;
+    m_used = 0;
+    m_sealed = false;
+  }
+
+  // Allocates an argument buffer for the next call.
+  void *argument(size_t size) {
+    if (m_sealed)
+      reset();
+    return alloc(size);
+  }
+
+  // Starts an export. Its arguments, if it has any, are kept, and from here on whatever the
+  // arena holds belongs to this call until the host makes the next one.
+  void enter() {
+    if (m_sealed)
+      reset();
+    m_sealed = true;
+  }
+
+  uint64_t peak() const { return m_peak; }
+  uint64_t reserved() const { return m_reserved; }
+
+private:
+  struct Chunk {
+    char *data;
+    size_t size;
+  };
+
+  bool grow(size_t size) {
+    size_t chunkSize = std::max(size, CHUNK_SIZE);
+    char *data = static_cast<char *>(boundary_alloc(chunkSize));
+    if (!data)
+      return false;
+    m_chunks.push_back(Chunk{data, chunkSize});
+    m_offset = 0;
+    m_reserved += chunkSize;
+    return true;
+  }
+
+  std::vector<Chunk> m_chunks;
+  size_t m_offset = 0;
+  uint64_t m_used = 0;
+  uint64_t m_peak = 0;
+  uint64_t m_reserved = 0;
+  bool m_sealed = false; // set from an export's start until the next argument is allocated
+};
+
+#ifdef TAGLIB_NATIVE
+#define g_arena (native_state<Arena>())
+#else
+static Arena g_arena;
+#endif
+
+// Keeps the data of the last picture read alive, so read_image can hand the host a view of
+// TagLib's own buffer rather than a copy. Valid until the next read_image or taglib_reset.
+#ifdef TAGLIB_NATIVE
+#define g_image (native_state<TagLib::ByteVector>())
+#else
+static TagLib::ByteVector g_image;
+#endif
+
+static void *host_alloc(size_t size) {
+  return g_arena.alloc(size);
+}
+
 char *to_char_array(const TagLib::String &s) {
   const std::string str = s.to8Bit(true);
-  return ::strdup(str.c_str());
+  char *buf = static_cast<char *>(host_alloc(str.size() + 1));
+  if (buf)
+    memcpy(buf, str.c_str(), str.size() + 1);
+  return buf;
 }
 
 TagLib::String to_string(const char *s) {
   return TagLib::String(s, TagLib::String::UTF8);
 }
 
+// ResultBuffer serializes rows of string fields into one contiguous buffer, so the host can
+// copy a whole result out of memory with a single read:
+//
+//   [u32 size][u32 rows] then for each field [u32 length][length bytes of UTF-8]
+//
+// size counts every byte after itself. Each kind of result has a fixed number of fields per
+// row, two (key, value) for tags.
+class ResultBuffer {
+public:
+  ResultBuffer() : m_data(8, '\0'), m_rows(0) {}
+
+  ResultBuffer &add(const TagLib::String &s) {
+    const std::string str = s.to8Bit(true);
+    return add(str.data(), str.size());
+  }
+
+  ResultBuffer &add(const char *data, size_t length) {
+    const uint32_t length32 = static_cast<uint32_t>(length);
+    m_data.append(reinterpret_cast<const char *>(&length32), sizeof(length32));
+    m_data.append(data, length);
+    return *this;
+  }
+
+  ResultBuffer &add(uint32_t value) {
+    return add(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void endRow() { m_rows++; }
+
+  void row(const TagLib::String &key, const TagLib::String &value) {
+    add(key).add(value).endRow();
+  }
+
+  char *finish() {
+    const uint32_t size = static_cast<uint32_t>(m_data.size() - 4);
+    memcpy(&m_data[0], &size, sizeof(size));
+    memcpy(&m_data[4], &m_rows, sizeof(m_rows));
+
+    char *buf = static_cast<char *>(host_alloc(m_data.size()));
+    if (buf)
+      memcpy(buf, m_data.data(), m_data.size());
+    return buf;
+  }
+
+private:
+  std::string m_data;
+  uint32_t m_rows;
+};
+
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
 
@@ -267,13 +787,47 @@ static const char *version_string =
     TOSTRING(TAGLIB_MINOR_VERSION) "."
     TOSTRING(TAGLIB_PATCH_VERSION);
 
-__attribute__((export_name("taglib_version"))) const char *
+TAGLIB_EXPORT("taglib_version") const char *
 taglib_version() {
+  g_arena.enter();
+#ifdef TAGLIB_NATIVE
+  // The host can only read the boundary region
+  return to_char_array(version_string);
+#else
   return version_string;
+#endif
+}
+
+TAGLIB_EXPORT("malloc") void *exported_malloc(size_t size) {
+  return g_arena.argument(size);
+}
+
+// Returns the module to its freshly initialised state so that a pooled instance can be
+// leased again: closes any handles left open and frees everything handed to the host.
+// Closing bumps the generation of each slot, so a stale handle from an earlier lease doesn't
+// resolve.
+TAGLIB_EXPORT("taglib_reset") void
+taglib_reset() {
+  g_handles.clear();
+  g_image = TagLib::ByteVector();
+  g_arena.reset();
 }
 
-__attribute__((export_name("malloc"))) void *exported_malloc(size_t size) {
-  return malloc(size);
+// Layout must match Go's wasmArenaStats
+struct ArenaStats {
+  uint64_t peak;     // most memory a single call's results and arguments have needed
+  uint64_t reserved; // memory currently held by the arena
+};
+
+TAGLIB_EXPORT("taglib_arena_stats") ArenaStats *
+taglib_arena_stats() {
+  g_arena.enter();
+  ArenaStats *stats = static_cast<ArenaStats *>(host_alloc(sizeof(ArenaStats)));
+  if (stats) {
+    stats->peak = g_arena.peak();
+    stats->reserved = g_arena.reserved();
+  }
+  return stats;
 }
 
 // ============================================================================
@@ -285,91 +839,193 @@ struct OpenResult {
   uint8_t format;
 };
 
-__attribute__((export_name("taglib_file_open"))) OpenResult *
-taglib_file_open(const char *filename, uint8_t readStyle) {
-  auto style = static_cast<TagLib::AudioProperties::ReadStyle>(readStyle);
-  TagLib::FileRef *fileRef = new TagLib::FileRef(filename, true, style);
-  if (fileRef->isNull()) {
-    delete fileRef;
+// Constructs the TagLib class for format directly, skipping FileRef's extension and content
+// detection. Returns null for FORMAT_UNKNOWN, or if source isn't valid in that format.
+template <typename Source>
+static TagLib::File *create_file(Source source, FileFormat format, bool readProperties,
+                                 TagLib::AudioProperties::ReadStyle style) {
+  TagLib::File *file;
+  switch (format) {
+    case FORMAT_MPEG:        file = new TagLib::MPEG::File(source, readProperties, style); break;
+    case FORMAT_MP4:         file = new TagLib::MP4::File(source, readProperties, style); break;
+    case FORMAT_FLAC:        file = new TagLib::FLAC::File(source, readProperties, style); break;
+    case FORMAT_OGG_VORBIS:  file = new TagLib::Ogg::Vorbis::File(source, readProperties, style); break;
+    case FORMAT_OGG_OPUS:    file = new TagLib::Ogg::Opus::File(source, readProperties, style); break;
+    case FORMAT_OGG_FLAC:    file = new TagLib::Ogg::FLAC::File(source, readProperties, style); break;
+    case FORMAT_OGG_SPEEX:   file = new TagLib::Ogg::Speex::File(source, readProperties, style); break;
+    case FORMAT_WAV:         file = new TagLib::RIFF::WAV::File(source, readProperties, style); break;
+    case FORMAT_AIFF:        file = new TagLib::RIFF::AIFF::File(source, readProperties, style); break;
+    case FORMAT_ASF:         file = new TagLib::ASF::File(source, readProperties, style); break;
+    case FORMAT_APE:         file = new TagLib::APE::File(source, readProperties, style); break;
+    case FORMAT_WAVPACK:     file = new TagLib::WavPack::File(source, readProperties, style); break;
+    case FORMAT_DSF:         file = new TagLib::DSF::File(source, readProperties, style); break;
+    case FORMAT_DSDIFF:      file = new TagLib::DSDIFF::File(source, readProperties, style); break;
+    case FORMAT_TRUE_AUDIO:  file = new TagLib::TrueAudio::File(source, readProperties, style); break;
+    case FORMAT_MPC:         file = new TagLib::MPC::File(source, readProperties, style); break;
+    case FORMAT_SHORTEN:     file = new TagLib::Shorten::File(source, readProperties, style); break;
+    case FORMAT_MATROSKA:    file = new TagLib::Matroska::File(source, readProperties, style); break;
+    default:                 return nullptr;
+  }
+  if (!file->isValid()) {
+    delete file;
     return nullptr;
   }
+  return file;
+}
 
-  OpenResult *result = static_cast<OpenResult *>(malloc(sizeof(OpenResult)));
-  if (!result) {
-    delete fileRef;
+// Opens source as the hinted format, falling back to FileRef's own detection if there's no
+// hint or it was wrong. Sets format to the one the file was opened as.
+template <typename Source>
+static TagLib::FileRef open_file_ref(Source source, FileFormat &format, bool readProperties,
+                                     TagLib::AudioProperties::ReadStyle style) {
+  if (TagLib::File *file = create_file(source, format, readProperties, style))
+    return TagLib::FileRef(file);
+
+  TagLib::FileRef fileRef(source, readProperties, style);
+  format = detect_format(fileRef.file());
+  return fileRef;
+}
+
+TAGLIB_EXPORT("taglib_file_open") OpenResult *
+taglib_file_open(const char *filename, uint8_t readStyle, uint8_t formatHint, uint8_t audioProperties) {
+  g_arena.enter();
+  auto style = static_cast<TagLib::AudioProperties::ReadStyle>(readStyle);
+  auto format = static_cast<FileFormat>(formatHint);
+  TagLib::FileRef fileRef = open_file_ref(filename, format, audioProperties, style);
+  if (fileRef.isNull())
+    return nullptr;
+
+  OpenResult *result = static_cast<OpenResult *>(host_alloc(sizeof(OpenResult)));
+  if (!result)
     return nullptr;
-  }
 
-  uint32_t handle = g_nextHandle++;
-  FileFormat format = detect_format(fileRef->file());
+  uint32_t handle = g_handles.acquire();
+  if (!handle)
+    return nullptr;
 
-  g_handles[handle] = FileHandle{fileRef, nullptr, format};
+  FileHandle *h = g_handles.get(handle);
+  h->fileRef = fileRef;
+  h->format = format;
+  h->filename = filename;
+  h->readStyle = style;
+  h->audioProperties = audioProperties;
 
   result->handle = handle;
   result->format = static_cast<uint8_t>(format);
   return result;
 }
 
-__attribute__((export_name("taglib_file_close"))) void
+TAGLIB_EXPORT("taglib_file_close") void
 taglib_file_close(uint32_t handle) {
-  auto it = g_handles.find(handle);
-  if (it != g_handles.end()) {
-    delete it->second.fileRef;
-    if (it->second.stream) {
-      delete it->second.stream;
-    }
-    g_handles.erase(it);
-  }
+  g_arena.enter();
+  g_handles.release(handle);
 }
 
-// Open a file from a Go io.ReadSeeker stream
-__attribute__((export_name("taglib_stream_open"))) OpenResult *
-taglib_stream_open(uint32_t streamId, const char *filename, uint8_t readStyle) {
-  GoIOStream *stream = new GoIOStream(streamId, filename);
+static OpenResult *open_stream(uint32_t streamId, const char *filename, int64_t length, bool writable,
+                               uint8_t readStyle, uint8_t formatHint, uint8_t audioProperties,
+                               uint64_t budgetBytes, uint32_t budgetReads) {
   auto style = static_cast<TagLib::AudioProperties::ReadStyle>(readStyle);
+  auto format = static_cast<FileFormat>(formatHint);
 
-  // FileRef takes ownership of the stream pointer for file operations
-  // but does NOT delete it - we manage it in FileHandle
-  TagLib::FileRef *fileRef = new TagLib::FileRef(stream, true, style);
-  if (fileRef->isNull()) {
-    delete fileRef;
-    delete stream;
+  uint32_t handle = g_handles.acquire();
+  if (!handle)
     return nullptr;
-  }
 
-  OpenResult *result = static_cast<OpenResult *>(malloc(sizeof(OpenResult)));
+  // The stream lives in the handle's slot, next to the file that reads it
+  FileHandle *h = g_handles.get(handle);
+  GoIOStream *stream = &h->stream.emplace(streamId, filename, length, writable);
+  // Saving moves data through reads too, so only probes are budgeted
+  if (!writable)
+    stream->setReadBudget(budgetBytes, budgetReads);
+  h->fileRef = open_file_ref(stream, format, audioProperties, style);
+
+  OpenResult *result = nullptr;
+  if (!h->fileRef.isNull())
+    result = static_cast<OpenResult *>(host_alloc(sizeof(OpenResult)));
   if (!result) {
-    delete fileRef;
-    delete stream;
+    g_handles.release(handle);
     return nullptr;
   }
 
-  uint32_t handle = g_nextHandle++;
-  FileFormat format = detect_format(fileRef->file());
-
-  g_handles[handle] = FileHandle{fileRef, stream, format};
+  h->format = format;
+  h->readStyle = style;
+  h->audioProperties = audioProperties;
 
   result->handle = handle;
   result->format = static_cast<uint8_t>(format);
   return result;
 }
 
+// Open a file from a Go io.ReadSeeker stream, or an io.ReadWriteSeeker if writable.
+// budgetBytes and budgetReads cap the reads of the stream, see GoIOStream::setReadBudget.
+TAGLIB_EXPORT("taglib_stream_open") OpenResult *
+taglib_stream_open(uint32_t streamId, const char *filename, uint8_t readStyle, uint8_t writable,
+                   uint8_t formatHint, uint8_t audioProperties, uint64_t budgetBytes,
+                   uint32_t budgetReads) {
+  g_arena.enter();
+  return open_stream(streamId, filename, -1, writable, readStyle, formatHint, audioProperties,
+                     budgetBytes, budgetReads);
+}
+
+// Open a file from a Go io.ReaderAt stream of the given size, also an io.WriterAt if writable
+TAGLIB_EXPORT("taglib_stream_open_reader_at") OpenResult *
+taglib_stream_open_reader_at(uint32_t streamId, int64_t size, const char *filename, uint8_t readStyle,
+                             uint8_t writable, uint8_t formatHint, uint8_t audioProperties,
+                             uint64_t budgetBytes, uint32_t budgetReads) {
+  g_arena.enter();
+  if (size < 0)
+    return nullptr;
+  return open_stream(streamId, filename, size, writable, readStyle, formatHint, audioProperties,
+                     budgetBytes, budgetReads);
+}
+
 // Helper to get FileRef from handle
 static TagLib::FileRef *get_file_ref(uint32_t handle) {
-  auto it = g_handles.find(handle);
-  if (it == g_handles.end()) return nullptr;
-  return it->second.fileRef;
+  FileHandle *h = g_handles.get(handle);
+  return h ? &h->fileRef : nullptr;
 }
 
 static FileFormat get_format(uint32_t handle) {
-  auto it = g_handles.find(handle);
-  if (it == g_handles.end()) return FORMAT_UNKNOWN;
-  return it->second.format;
+  FileHandle *h = g_handles.get(handle);
+  return h ? h->format : FORMAT_UNKNOWN;
+}
+
+// Returns the stream handle was opened from, or null if it was opened from a path
+static GoIOStream *get_stream(uint32_t handle) {
+  FileHandle *h = g_handles.get(handle);
+  return h ? h->goStream() : nullptr;
+}
+
+// Returns the read counters of a stream handle, or null if the handle wasn't opened from a stream.
+TAGLIB_EXPORT("taglib_handle_stream_stats") StreamStats *
+taglib_handle_stream_stats(uint32_t handle) {
+  g_arena.enter();
+  FileHandle *h = g_handles.get(handle);
+  if (!h || !h->stream) return nullptr;
+
+  StreamStats *stats = static_cast<StreamStats *>(host_alloc(sizeof(StreamStats)));
+  if (stats)
+    *stats = h->stream->stats();
+  return stats;
+}
+
+// Converts a null terminated array of keys to upper case, the way PropertyMap stores them,
+// dropping duplicates
+static TagLib::StringList read_keys(guest_strings keys) {
+  TagLib::StringList list;
+  for (size_t i = 0; keys[i]; i++) {
+    auto key = TagLib::String(keys[i], TagLib::String::UTF8).upper();
+    if (!list.contains(key))
+      list.append(key);
+  }
+  return list;
 }
 
 // Supplements Matroska properties() with tags that TagLib misses from ffmpeg files:
 // non-standard Album-level SimpleTags, track-bound tags, and segment title fallback.
-static TagLib::PropertyMap enrich_matroska_properties(TagLib::FileRef &fileRef) {
+// If keys isn't null, only tags with those (upper case) keys are looked for.
+static TagLib::PropertyMap enrich_matroska_properties(TagLib::FileRef &fileRef,
+                                                      const TagLib::StringList *keys = nullptr) {
   auto properties = fileRef.properties();
   auto *mkFile = dynamic_cast<TagLib::Matroska::File *>(fileRef.file());
   if (!mkFile)
@@ -379,6 +1035,11 @@ static TagLib::PropertyMap enrich_matroska_properties(TagLib::FileRef &fileRef)
   if (!mkTag)
     return properties;
 
+  // Nothing left to look for when every wanted key is already there
+  if (keys && std::all_of(keys->begin(), keys->end(),
+                          [&](const TagLib::String &k) { return properties.contains(k); }))
+    return properties;
+
   // Album-level SimpleTag names already handled by TagLib's translation table.
   static const TagLib::StringList knownAlbumTags = {
     "TITLE", "ARTIST", "PART_NUMBER", "TOTAL_PARTS", "TITLESORT",
@@ -398,6 +1059,8 @@ static TagLib::PropertyMap enrich_matroska_properties(TagLib::FileRef &fileRef)
     TagLib::String name = st.name();
     if (name.isEmpty() || properties.contains(name) || knownAlbumTags.contains(name))
       continue;
+    if (keys && !keys->contains(name.upper()))
+      continue;
     properties[name].append(st.toString());
   }
 
@@ -406,7 +1069,7 @@ static TagLib::PropertyMap enrich_matroska_properties(TagLib::FileRef &fileRef)
   static const TagLib::StringList internalTrackTags = {
     "DURATION", "ENCODER", "ENCODER_SETTINGS",
   };
-  for (const auto &key : fileRef.complexPropertyKeys()) {
+  for (const auto &key : keys ? *keys : fileRef.complexPropertyKeys()) {
     if (key == "PICTURE" || properties.contains(key) || internalTrackTags.contains(key))
       continue;
     for (const auto &prop : fileRef.complexProperties(key)) {
@@ -427,49 +1090,60 @@ static TagLib::PropertyMap enrich_matroska_properties(TagLib::FileRef &fileRef)
   return properties;
 }
 
-// Helper to serialize properties to string array
-static char **serialize_properties(const TagLib::PropertyMap &properties) {
-  size_t len = 0;
+// Helper to serialize properties to a result buffer
+static char *serialize_properties(const TagLib::PropertyMap &properties) {
+  ResultBuffer out;
   for (const auto &kvs : properties)
-    len += kvs.second.size();
-
-  char **tags = static_cast<char **>(malloc(sizeof(char *) * (len + 1)));
-  if (!tags)
-    return nullptr;
-
-  size_t i = 0;
-  for (const auto &kvs : properties)
-    for (const auto &v : kvs.second) {
-      TagLib::String row = kvs.first + "\t" + v;
-      tags[i] = to_char_array(row);
-      i++;
-    }
-  tags[len] = nullptr;
-
-  return tags;
+    for (const auto &v : kvs.second)
+      out.row(kvs.first, v);
+  return out.finish();
 }
 
-__attribute__((export_name("taglib_handle_tags"))) char **
+TAGLIB_EXPORT("taglib_handle_tags") char *
 taglib_handle_tags(uint32_t handle) {
+  g_arena.enter();
   TagLib::FileRef *fileRef = get_file_ref(handle);
   if (!fileRef)
     return nullptr;
   return serialize_properties(enrich_matroska_properties(*fileRef));
 }
 
-// Forward declarations for raw tag helpers
-static char **read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag);
-static char **read_mp4_items_from_tag(TagLib::MP4::Tag *mp4Tag);
-static char **read_asf_attributes_from_tag(TagLib::ASF::Tag *asfTag);
+// Like serializing all the tags, but only converts the values of the null terminated keys
+static char *read_tags_keys(TagLib::FileRef &fileRef, guest_strings keys) {
+  const auto wanted = read_keys(keys);
+  const auto properties = enrich_matroska_properties(fileRef, &wanted);
 
-__attribute__((export_name("taglib_handle_raw_tags"))) char **
-taglib_handle_raw_tags(uint32_t handle) {
+  ResultBuffer out;
+  for (const auto &key : wanted) {
+    auto it = properties.find(key);
+    if (it == properties.end())
+      continue;
+    for (const auto &v : it->second)
+      out.row(it->first, v);
+  }
+  return out.finish();
+}
+
+TAGLIB_EXPORT("taglib_handle_tags_keys") char *
+taglib_handle_tags_keys(uint32_t handle, guest_strings keys) {
+  g_arena.enter();
   TagLib::FileRef *fileRef = get_file_ref(handle);
-  if (!fileRef || fileRef->isNull())
+  if (!fileRef || !keys)
     return nullptr;
+  return read_tags_keys(*fileRef, keys);
+}
+
+// Forward declarations for raw tag helpers
+static char *read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag);
+static char *read_mp4_items_from_tag(TagLib::MP4::Tag *mp4Tag);
+static char *read_asf_attributes_from_tag(TagLib::ASF::Tag *asfTag);
 
-  FileFormat format = get_format(handle);
-  TagLib::File *file = fileRef->file();
+// Reads format-specific tags: ID3v2 frames, MP4 atoms or ASF attributes. Formats without
+// them (FLAC, OGG, etc.) use Vorbis Comments, so the normalized properties are returned
+// instead, computed here if the caller doesn't already have them.
+static char *read_raw_tags(TagLib::FileRef &fileRef, FileFormat format,
+                            const TagLib::PropertyMap *properties) {
+  TagLib::File *file = fileRef.file();
 
   // Route based on format
   switch (format) {
@@ -504,15 +1178,22 @@ taglib_handle_raw_tags(uint32_t handle) {
       break;
     }
     default:
-      // For formats without format-specific tags (FLAC, OGG, etc.),
-      // return the same as normalized tags (they use Vorbis Comments)
-      return serialize_properties(enrich_matroska_properties(*fileRef));
+      if (properties)
+        return serialize_properties(*properties);
+      return serialize_properties(enrich_matroska_properties(fileRef));
   }
 
-  // Return empty array
-  char **empty = static_cast<char **>(malloc(sizeof(char *)));
-  if (empty) empty[0] = nullptr;
-  return empty;
+  // Return empty result
+  return ResultBuffer().finish();
+}
+
+TAGLIB_EXPORT("taglib_handle_raw_tags") char *
+taglib_handle_raw_tags(uint32_t handle) {
+  g_arena.enter();
+  TagLib::FileRef *fileRef = get_file_ref(handle);
+  if (!fileRef || fileRef->isNull())
+    return nullptr;
+  return read_raw_tags(*fileRef, get_format(handle), nullptr);
 }
 
 struct FileProperties {
@@ -521,8 +1202,9 @@ struct FileProperties {
   uint32_t sampleRate;
   uint32_t bitrate;
   uint32_t bitsPerSample;
-  char **imageMetadata;
-  char *codec;
+  guest_ptr<char> imageMetadata;
+  guest_ptr<char> codec;
+  uint32_t estimated; // a stream's read budget ran out, see GoIOStream::setReadBudget
 };
 
 static int extract_bits_per_sample(const TagLib::AudioProperties *audioProperties) {
@@ -590,33 +1272,111 @@ static char* extract_codec(const TagLib::AudioProperties *audioProperties) {
   return codec.isEmpty() ? nullptr : to_char_array(codec);
 }
 
-static char** extract_image_metadata(const TagLib::List<TagLib::VariantMap> &pictures) {
-  if (pictures.isEmpty())
-    return nullptr;
+// ID3v2 tag of MPEG, WAV or AIFF files, if present.
+static TagLib::ID3v2::Tag *find_id3v2_tag(TagLib::File *file) {
+  if (auto *mpegFile = dynamic_cast<TagLib::MPEG::File *>(file))
+    return mpegFile->hasID3v2Tag() ? mpegFile->ID3v2Tag() : nullptr;
+  if (auto *wavFile = dynamic_cast<TagLib::RIFF::WAV::File *>(file))
+    return wavFile->hasID3v2Tag() ? wavFile->ID3v2Tag() : nullptr;
+  if (auto *aiffFile = dynamic_cast<TagLib::RIFF::AIFF::File *>(file))
+    return aiffFile->hasID3v2Tag() ? aiffFile->tag() : nullptr;
+  return nullptr;
+}
 
-  size_t len = pictures.size();
-  char **imageMetadata = static_cast<char **>(malloc(sizeof(char *) * (len + 1)));
-  if (!imageMetadata)
-    return nullptr;
+// MIME type MP4::Tag reports for a cover in complexProperties("PICTURE")
+static TagLib::String mp4_cover_mime_type(TagLib::MP4::CoverArt::Format format) {
+  switch (format) {
+    case TagLib::MP4::CoverArt::JPEG: return "image/jpeg";
+    case TagLib::MP4::CoverArt::PNG: return "image/png";
+    case TagLib::MP4::CoverArt::BMP: return "image/bmp";
+    case TagLib::MP4::CoverArt::GIF: return "image/gif";
+    default: return "image/";
+  }
+}
+
+// Calls fn(pictureType, description, mimeType, data) for each picture of file until it
+// returns false, in the order complexProperties("PICTURE") reports them.
+//
+// Where the format has a picture list of its own (FLAC and Xiph pictures, ID3v2 APIC
+// frames, MP4 covr items and ASF WM/Picture attributes), it's walked directly, so only the
+// already parsed pictures are referenced. complexProperties would instead build a variant
+// map with a copy of every picture only for us to drop the data. It's still used for APE
+// cover items and Matroska attachments, which TagLib only turns into pictures while
+// building that map: the description is split off the APE item's data, and attachments
+// are picked by media type.
+template <typename Fn>
+static void visit_pictures(TagLib::FileRef &file, Fn fn) {
+  TagLib::File *f = file.file();
+
+  auto visitFlac = [&](const TagLib::List<TagLib::FLAC::Picture *> &pictures) {
+    for (const auto *p : pictures) {
+      if (!fn(TagLib::FLAC::Picture::typeToString(p->type()), p->description(), p->mimeType(), p->data()))
+        return;
+    }
+  };
+
+  if (auto *flacFile = dynamic_cast<TagLib::FLAC::File *>(f)) {
+    visitFlac(flacFile->pictureList());
+    return;
+  }
+  if (auto *xiph = dynamic_cast<TagLib::Ogg::XiphComment *>(f->tag())) {
+    visitFlac(xiph->pictureList());
+    return;
+  }
+  if (TagLib::ID3v2::Tag *id3v2Tag = find_id3v2_tag(f);
+      id3v2Tag && !id3v2Tag->frameList("APIC").isEmpty()) {
+    for (const auto *frame : id3v2Tag->frameList("APIC")) {
+      auto *apic = dynamic_cast<const TagLib::ID3v2::AttachedPictureFrame *>(frame);
+      if (!apic)
+        continue;
+      if (!fn(TagLib::ID3v2::AttachedPictureFrame::typeToString(apic->type()), apic->description(),
+              apic->mimeType(), apic->picture()))
+        return;
+    }
+    return;
+  }
+  if (auto *mp4Tag = dynamic_cast<TagLib::MP4::Tag *>(f->tag())) {
+    for (const auto &cover : mp4Tag->item("covr").toCoverArtList()) {
+      if (!fn(TagLib::String(), TagLib::String(), mp4_cover_mime_type(cover.format()), cover.data()))
+        return;
+    }
+    return;
+  }
+  if (auto *asfTag = dynamic_cast<TagLib::ASF::Tag *>(f->tag())) {
+    for (const auto &attribute : asfTag->attribute("WM/Picture")) {
+      const TagLib::ASF::Picture picture = attribute.toPicture();
+      if (!fn(TagLib::ASF::Picture::typeToString(picture.type()), picture.description(),
+              picture.mimeType(), picture.picture()))
+        return;
+    }
+    return;
+  }
 
-  size_t i = 0;
-  for (const auto &p : pictures) {
-    TagLib::String type = p["pictureType"].toString();
-    TagLib::String desc = p["description"].toString();
-    TagLib::String mime = p["mimeType"].toString();
-    TagLib::String row = type + "\t" + desc + "\t" + mime;
-    imageMetadata[i] = to_char_array(row);
-    i++;
+  for (const auto &p : file.complexProperties("PICTURE")) {
+    if (!fn(p["pictureType"].toString(), p["description"].toString(), p["mimeType"].toString(),
+            p["data"].toByteVector()))
+      return;
   }
-  imageMetadata[len] = nullptr;
-  return imageMetadata;
 }
 
-static FileProperties* read_file_properties(TagLib::FileRef &file) {
+// Serializes picture metadata as rows of pictureType, description, mimeType, size, in the
+// order of visit_pictures so the indices match read_image.
+static char *extract_image_metadata(TagLib::FileRef &file) {
+  ResultBuffer out;
+  visit_pictures(file, [&](const TagLib::String &pictureType, const TagLib::String &description,
+                           const TagLib::String &mimeType, const TagLib::ByteVector &data) {
+    out.add(pictureType).add(description).add(mimeType).add(static_cast<uint32_t>(data.size())).endRow();
+    return true;
+  });
+  return out.finish();
+}
+
+// stream is the one file was opened from, or null if it was opened from a path
+static FileProperties* read_file_properties(TagLib::FileRef &file, GoIOStream *stream = nullptr) {
   if (file.isNull() || !file.audioProperties())
     return nullptr;
 
-  FileProperties *props = static_cast<FileProperties *>(malloc(sizeof(FileProperties)));
+  FileProperties *props = static_cast<FileProperties *>(host_alloc(sizeof(FileProperties)));
   if (!props)
     return nullptr;
 
@@ -627,71 +1387,194 @@ static FileProperties* read_file_properties(TagLib::FileRef &file) {
   props->bitrate = audioProperties->bitrate();
   props->bitsPerSample = extract_bits_per_sample(audioProperties);
   props->codec = extract_codec(audioProperties);
-  props->imageMetadata = extract_image_metadata(file.complexProperties("PICTURE"));
+  props->imageMetadata = extract_image_metadata(file);
+  props->estimated = 0;
+
+  // TagLib couldn't read as far as it wanted. Without a length, estimate one from the
+  // stream's size at the bitrate it did find, as if it were all constant bitrate audio.
+  if (stream && stream->budgetExhausted()) {
+    props->estimated = 1;
+    if (props->lengthInMilliseconds == 0 && props->bitrate > 0)
+      props->lengthInMilliseconds = static_cast<uint32_t>(stream->length() * 8 / props->bitrate);
+  }
 
   return props;
 }
 
-__attribute__((export_name("taglib_handle_properties"))) FileProperties *
+// Returns the FileRef of handle with audio properties read. A handle opened without them is
+// reopened from its path or stream the first time they're needed.
+static TagLib::FileRef *get_file_ref_with_properties(uint32_t handle) {
+  FileHandle *h = g_handles.get(handle);
+  if (!h) return nullptr;
+  if (h->audioProperties)
+    return &h->fileRef;
+
+  FileFormat format = h->format;
+  TagLib::FileRef fileRef = h->stream
+    ? open_file_ref(h->goStream(), format, true, h->readStyle)
+    : open_file_ref(h->filename.c_str(), format, true, h->readStyle);
+  if (!fileRef.isNull()) {
+    h->fileRef = fileRef;
+    h->audioProperties = true;
+  }
+  return &h->fileRef;
+}
+
+TAGLIB_EXPORT("taglib_handle_properties") FileProperties *
 taglib_handle_properties(uint32_t handle) {
-  TagLib::FileRef *fileRef = get_file_ref(handle);
+  g_arena.enter();
+  TagLib::FileRef *fileRef = get_file_ref_with_properties(handle);
   if (!fileRef)
     return nullptr;
-  return read_file_properties(*fileRef);
+  return read_file_properties(*fileRef, get_stream(handle));
 }
 
-struct ByteData {
-  uint32_t length;
-  char *data;
+struct ReadAllResult {
+  guest_ptr<char> tags;
+  guest_ptr<char> rawTags;
+  guest_ptr<FileProperties> properties;
+  uint8_t format;
 };
 
-static ByteData* read_image(TagLib::FileRef &file, int index) {
-  if (file.isNull())
+// Reads tags, raw tags, audio properties and image metadata in a single pass over the file,
+// sharing the normalized properties between the tags and the raw tag fallback.
+static ReadAllResult *read_all(TagLib::FileRef &fileRef, FileFormat format, GoIOStream *stream = nullptr) {
+  if (fileRef.isNull())
     return nullptr;
 
-  const auto &pictures = file.complexProperties("PICTURE");
-  if (pictures.isEmpty())
+  ReadAllResult *result = static_cast<ReadAllResult *>(host_alloc(sizeof(ReadAllResult)));
+  if (!result)
     return nullptr;
 
-  if (index < 0 || index >= static_cast<int>(pictures.size()))
-    return nullptr;
+  const auto properties = enrich_matroska_properties(fileRef);
+  result->tags = serialize_properties(properties);
+  result->rawTags = read_raw_tags(fileRef, format, &properties);
+  result->properties = read_file_properties(fileRef, stream);
+  result->format = static_cast<uint8_t>(format);
+  return result;
+}
 
-  auto v = pictures[index]["data"].toByteVector();
-  ByteData *bd = static_cast<ByteData *>(malloc(sizeof(ByteData)));
-  if (!bd)
+TAGLIB_EXPORT("taglib_handle_read_all") ReadAllResult *
+taglib_handle_read_all(uint32_t handle) {
+  g_arena.enter();
+  TagLib::FileRef *fileRef = get_file_ref_with_properties(handle);
+  if (!fileRef)
     return nullptr;
+  return read_all(*fileRef, get_format(handle), get_stream(handle));
+}
 
-  bd->length = static_cast<uint32_t>(v.size());
-  if (bd->length == 0) {
-    bd->data = nullptr;
-    return bd;
-  }
+struct ByteData {
+  uint32_t length;
+  guest_ptr<char> data;
+};
+
+// Sets data to the picture at index, in the order extract_image_metadata lists them. Like
+// it, this goes through visit_pictures, so only the selected picture is referenced where the
+// format has a picture list of its own.
+static bool find_image(TagLib::FileRef &file, int index, TagLib::ByteVector &data) {
+  if (file.isNull() || index < 0)
+    return false;
+
+  bool found = false;
+  int i = 0;
+  visit_pictures(file, [&](const TagLib::String &, const TagLib::String &, const TagLib::String &,
+                           const TagLib::ByteVector &picture) {
+    if (i++ < index)
+      return true;
+    data = picture;
+    found = true;
+    return false;
+  });
+  return found;
+}
 
-  char *buf = static_cast<char *>(malloc(bd->length));
-  if (!buf)
+static ByteData* read_image(TagLib::FileRef &file, int index) {
+  if (!find_image(file, index, g_image))
     return nullptr;
 
-  memcpy(buf, v.data(), bd->length);
-  bd->data = buf;
+  ByteData *bd = static_cast<ByteData *>(host_alloc(sizeof(ByteData)));
+  if (!bd)
+    return nullptr;
 
+  bd->length = static_cast<uint32_t>(g_image.size());
+#ifdef TAGLIB_NATIVE
+  // The host can only read the boundary region, so this build hands it a copy
+  bd->data = bd->length == 0 ? nullptr : static_cast<char *>(host_alloc(bd->length));
+  if (bd->length != 0 && !bd->data)
+    return nullptr;
+  if (bd->data)
+    memcpy(bd->data, g_image.data(), bd->length);
+#else
+  // The const overload of data() doesn't detach, so this doesn't copy a shared buffer
+  const TagLib::ByteVector &image = g_image;
+  bd->data = bd->length == 0 ? nullptr : const_cast<char *>(image.data());
+#endif
   return bd;
 }
 
-__attribute__((export_name("taglib_handle_image"))) ByteData *
+TAGLIB_EXPORT("taglib_handle_image") ByteData *
 taglib_handle_image(uint32_t handle, int index) {
+  g_arena.enter();
   TagLib::FileRef *fileRef = get_file_ref(handle);
   if (!fileRef)
     return nullptr;
   return read_image(*fileRef, index);
 }
 
+// Returns the size of the image at index in bytes, or -1 if there's no such image. data
+// shares the picture's buffer, so nothing is copied.
+TAGLIB_EXPORT("taglib_handle_image_size") int
+taglib_handle_image_size(uint32_t handle, int index) {
+  g_arena.enter();
+  TagLib::FileRef *fileRef = get_file_ref(handle);
+  TagLib::ByteVector data;
+  if (!fileRef || !find_image(*fileRef, index, data))
+    return -1;
+  return static_cast<int>(data.size());
+}
+
 static const uint8_t CLEAR = 1 << 0;
 
-static bool write_tags(TagLib::FileRef &file, const char **tags, uint8_t opts) {
+// Result of a write export. Must match Go's writeStatus
+enum WriteStatus : uint8_t {
+  WRITE_FAILED = 0,
+  WRITE_SAVED = 1,
+  WRITE_UNCHANGED = 2, // the changes matched what the file already had, so it wasn't saved
+  WRITE_SAVED_IN_PLACE = 3, // saved without changing the file's length, so no audio was moved
+  WRITE_PADDING_LEFT = 4, // saved, but the padding placeholder couldn't be removed, see save_with_padding
+};
+
+// Saves file, telling apart saves that fit in the existing tag space from full rewrites.
+// stream is the one file was opened from, if any, so that its write failures are caught.
+static uint8_t save_file(TagLib::File *file, GoIOStream *stream = nullptr) {
+#ifdef TAGLIB_NATIVE
+  if (!stream && native_read_only())
+    return WRITE_FAILED;
+#endif
+  if (stream)
+    stream->clearWriteFailed();
+
+  const auto before = file->length();
+  if (!file->save() || (stream && stream->writeFailed()))
+    return WRITE_FAILED;
+  return file->length() == before ? WRITE_SAVED_IN_PLACE : WRITE_SAVED;
+}
+
+// Saves file if any change was applied to it, leaving it untouched otherwise
+static uint8_t save_if_changed(TagLib::FileRef &file, bool changed, GoIOStream *stream) {
+  if (!changed)
+    return WRITE_UNCHANGED;
+  return save_file(file.file(), stream);
+}
+
+// Applies tag changes to file in memory, without saving it. Sets changed if the resulting
+// tags differ from the file's current ones.
+static bool apply_tags(TagLib::FileRef &file, guest_strings tags, uint8_t opts, bool &changed) {
   if (file.isNull() || !tags)
     return false;
 
-  auto properties = file.properties();
+  const auto current = file.properties();
+  auto properties = current;
   if (opts & CLEAR)
     properties.clear();
 
@@ -708,101 +1591,142 @@ static bool write_tags(TagLib::FileRef &file, const char **tags, uint8_t opts) {
   }
 
   // For Matroska, clearSimpleTags() removes all tags including track-bound
-  // ones that setProperties() alone would preserve.
+  // ones that setProperties() alone would preserve. Those aren't in properties(),
+  // so there's no telling whether clearing changes anything.
+  bool clearMatroska = false;
   if ((opts & CLEAR)) {
     auto *mkFile = dynamic_cast<TagLib::Matroska::File *>(file.file());
     if (mkFile) {
       auto *mkTag = dynamic_cast<TagLib::Matroska::Tag *>(mkFile->tag());
-      if (mkTag)
+      if (mkTag) {
         mkTag->clearSimpleTags();
+        clearMatroska = true;
+      }
     }
   }
+
+  if (properties == current && !clearMatroska)
+    return true;
+  changed = true;
   file.setProperties(properties);
-  return file.save();
+  return true;
 }
 
-__attribute__((export_name("taglib_handle_write_tags"))) bool
-taglib_handle_write_tags(uint32_t handle, const char **tags, uint8_t opts) {
+static uint8_t write_tags(TagLib::FileRef &file, guest_strings tags, uint8_t opts,
+                          GoIOStream *stream = nullptr) {
+  bool changed = false;
+  if (!apply_tags(file, tags, opts, changed))
+    return WRITE_FAILED;
+  return save_if_changed(file, changed, stream);
+}
+
+TAGLIB_EXPORT("taglib_handle_write_tags") uint8_t
+taglib_handle_write_tags(uint32_t handle, guest_strings tags, uint8_t opts) {
+  g_arena.enter();
   TagLib::FileRef *fileRef = get_file_ref(handle);
   if (!fileRef)
-    return false;
-  return write_tags(*fileRef, tags, opts);
+    return WRITE_FAILED;
+  return write_tags(*fileRef, tags, opts, get_stream(handle));
 }
 
-static bool write_image(TagLib::FileRef &file, const char *buf, uint32_t length,
-                       int index, const char *pictureType,
-                       const char *description, const char *mimeType) {
-  if (file.isNull())
-    return false;
-
-  auto pictures = file.complexProperties("PICTURE");
+// Replaces the picture at index in pictures, or appends it if index is out of range. An
+// empty picture removes the one at index instead.
+static void edit_pictures(TagLib::List<TagLib::VariantMap> &pictures, const char *buf, uint32_t length,
+                          int index, const TagLib::String &pictureType,
+                          const TagLib::String &description, const TagLib::String &mimeType) {
+  bool inRange = index >= 0 && index < static_cast<int>(pictures.size());
 
   if (length == 0) {
-    if (index >= 0 && index < static_cast<int>(pictures.size())) {
+    if (inRange) {
       auto it = pictures.begin();
       std::advance(it, index);
       pictures.erase(it);
-      if (!file.setComplexProperties("PICTURE", pictures))
-        return false;
     }
-    return file.save();
+    return;
   }
 
   TagLib::VariantMap newPicture;
   newPicture["data"] = TagLib::ByteVector(buf, length);
-  newPicture["pictureType"] = to_string(pictureType);
-  newPicture["description"] = to_string(description);
-  newPicture["mimeType"] = to_string(mimeType);
+  newPicture["pictureType"] = pictureType;
+  newPicture["description"] = description;
+  newPicture["mimeType"] = mimeType;
 
-  if (index >= 0 && index < static_cast<int>(pictures.size()))
-    pictures[index] = newPicture;
-  else
+  if (!inRange) {
     pictures.append(newPicture);
+    return;
+  }
 
-  if (!file.setComplexProperties("PICTURE", pictures))
+  // Leave the picture alone if it already has every field the format stores, so that
+  // rewriting the same picture isn't seen as a change
+  const auto &existing = pictures[index];
+  for (const auto &field : newPicture) {
+    if (existing.contains(field.first) && existing[field.first] != field.second) {
+      pictures[index] = newPicture;
+      return;
+    }
+  }
+}
+
+// Applies picture edits to file in memory, without saving it. Sets changed if the resulting
+// pictures differ from the file's current ones.
+static bool apply_pictures(TagLib::FileRef &file, const TagLib::List<TagLib::VariantMap> &current,
+                           const TagLib::List<TagLib::VariantMap> &pictures, bool &changed) {
+  if (pictures == current)
+    return true;
+  if (!file.setComplexProperties("PICTURE", pictures))
     return false;
+  changed = true;
+  return true;
+}
+
+static uint8_t write_image(TagLib::FileRef &file, const char *buf, uint32_t length,
+                           int index, const char *pictureType,
+                           const char *description, const char *mimeType,
+                           GoIOStream *stream = nullptr) {
+  if (file.isNull())
+    return WRITE_FAILED;
 
-  return file.save();
+  const auto current = file.complexProperties("PICTURE");
+  auto pictures = current;
+  edit_pictures(pictures, buf, length, index, to_string(pictureType), to_string(description), to_string(mimeType));
+
+  bool changed = false;
+  if (!apply_pictures(file, current, pictures, changed))
+    return WRITE_FAILED;
+  return save_if_changed(file, changed, stream);
 }
 
-__attribute__((export_name("taglib_handle_write_image"))) bool
+TAGLIB_EXPORT("taglib_handle_write_image") uint8_t
 taglib_handle_write_image(uint32_t handle, const char *buf, uint32_t length,
                           int index, const char *pictureType,
                           const char *description, const char *mimeType) {
+  g_arena.enter();
   TagLib::FileRef *fileRef = get_file_ref(handle);
   if (!fileRef)
-    return false;
-  return write_image(*fileRef, buf, length, index, pictureType, description, mimeType);
+    return WRITE_FAILED;
+  return write_image(*fileRef, buf, length, index, pictureType, description, mimeType,
+                     get_stream(handle));
 }
 
 // ============================================================================
 // Helper functions for raw tag extraction (shared by handle and path APIs)
 // ============================================================================
 
-static char **read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag) {
-  if (!id3v2Tag) {
-    char **empty = static_cast<char **>(malloc(sizeof(char *)));
-    if (empty) empty[0] = nullptr;
-    return empty;
-  }
-
-  const TagLib::ID3v2::FrameListMap &frameListMap = id3v2Tag->frameListMap();
-
-  size_t frameCount = 0;
-  for (TagLib::ID3v2::FrameListMap::ConstIterator it = frameListMap.begin(); it != frameListMap.end(); ++it) {
-    frameCount += it->second.size();
-  }
-
-  if (frameCount == 0) {
-    char **empty = static_cast<char **>(malloc(sizeof(char *)));
-    if (empty) empty[0] = nullptr;
-    return empty;
-  }
+// Formats a 3 character ID3v2 language code, or "xxx" if it's missing.
+static TagLib::String language_code(const TagLib::ByteVector &lang) {
+  if (lang.size() != 3)
+    return "xxx";
+  char langBuf[4] = {0};
+  memcpy(langBuf, lang.data(), 3);
+  return TagLib::String(langBuf);
+}
 
-  char **frames = static_cast<char **>(malloc(sizeof(char *) * (frameCount + 1)));
-  if (!frames) return nullptr;
+static char *read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag) {
+  ResultBuffer out;
+  if (!id3v2Tag)
+    return out.finish();
 
-  size_t i = 0;
+  const TagLib::ID3v2::FrameListMap &frameListMap = id3v2Tag->frameListMap();
   for (TagLib::ID3v2::FrameListMap::ConstIterator it = frameListMap.begin(); it != frameListMap.end(); ++it) {
     TagLib::String frameID = TagLib::String(it->first);
 
@@ -810,7 +1734,9 @@ static char **read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag) {
       TagLib::String key = frameID;
       TagLib::String value;
 
+      // Handle special frame types
       if (frameID == "TXXX") {
+        // User text identification frame
         auto userFrame = dynamic_cast<TagLib::ID3v2::UserTextIdentificationFrame *>(*frameIt);
         if (userFrame) {
           key = frameID + ":" + userFrame->description();
@@ -820,6 +1746,7 @@ static char **read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag) {
         }
       }
       else if (frameID == "COMM") {
+        // Comments frame
         auto commFrame = dynamic_cast<TagLib::ID3v2::CommentsFrame *>(*frameIt);
         if (commFrame) {
           key = frameID + ":" + commFrame->description();
@@ -827,6 +1754,7 @@ static char **read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag) {
         }
       }
       else if (frameID == "POPM") {
+        // Popularimeter frame (used for WMP ratings)
         auto popmFrame = dynamic_cast<TagLib::ID3v2::PopularimeterFrame *>(*frameIt);
         if (popmFrame) {
           key = frameID + ":" + popmFrame->email();
@@ -834,37 +1762,28 @@ static char **read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag) {
         }
       }
       else if (frameID == "USLT") {
+        // Unsynchronized lyrics frame
         auto usltFrame = dynamic_cast<TagLib::ID3v2::UnsynchronizedLyricsFrame *>(*frameIt);
         if (usltFrame) {
-          TagLib::ByteVector lang = usltFrame->language();
-          TagLib::String langStr = "xxx";
-          if (lang.size() == 3) {
-            char langBuf[4] = {0};
-            memcpy(langBuf, lang.data(), 3);
-            langStr = TagLib::String(langBuf);
-          }
-          key = frameID + ":" + langStr;
+          key = frameID + ":" + language_code(usltFrame->language());
           value = usltFrame->text();
         }
       }
       else if (frameID == "SYLT") {
+        // Synchronized lyrics frame - convert to LRC format
         auto syltFrame = dynamic_cast<TagLib::ID3v2::SynchronizedLyricsFrame *>(*frameIt);
         if (syltFrame) {
-          TagLib::ByteVector lang = syltFrame->language();
-          TagLib::String langStr = "xxx";
-          if (lang.size() == 3) {
-            char langBuf[4] = {0};
-            memcpy(langBuf, lang.data(), 3);
-            langStr = TagLib::String(langBuf);
-          }
-          key = frameID + ":" + langStr;
+          key = frameID + ":" + language_code(syltFrame->language());
 
+          // Build LRC format from synchronized text
           TagLib::String lrc;
           auto format = syltFrame->timestampFormat();
           for (const auto &syncText : syltFrame->synchedText()) {
             int timeMs = syncText.time;
-            if (format == TagLib::ID3v2::SynchronizedLyricsFrame::AbsoluteMpegFrames)
+            if (format == TagLib::ID3v2::SynchronizedLyricsFrame::AbsoluteMpegFrames) {
+              // Skip MPEG frames format - would need sample rate to convert
               continue;
+            }
             int mins = timeMs / 60000;
             int secs = (timeMs % 60000) / 1000;
             int centis = (timeMs % 1000) / 10;
@@ -876,150 +1795,88 @@ static char **read_id3v2_frames_from_tag(TagLib::ID3v2::Tag *id3v2Tag) {
         }
       }
       else {
+        // Standard frame
         value = (*frameIt)->toString();
       }
 
-      TagLib::String row = key + "\t" + value;
-      frames[i++] = to_char_array(row);
+      out.row(key, value);
     }
   }
 
-  frames[i] = nullptr;
-  return frames;
+  return out.finish();
 }
 
-static char **read_mp4_items_from_tag(TagLib::MP4::Tag *mp4Tag) {
-  if (!mp4Tag) {
-    char **empty = static_cast<char **>(malloc(sizeof(char *)));
-    if (empty) empty[0] = nullptr;
-    return empty;
-  }
+static char *read_mp4_items_from_tag(TagLib::MP4::Tag *mp4Tag) {
+  ResultBuffer out;
+  if (!mp4Tag)
+    return out.finish();
 
   const TagLib::MP4::ItemMap &itemMap = mp4Tag->itemMap();
-
-  size_t atomCount = 0;
-  for (auto it = itemMap.begin(); it != itemMap.end(); ++it) {
-    TagLib::MP4::Item item = it->second;
-    switch (item.type()) {
-      case TagLib::MP4::Item::Type::StringList:
-        atomCount += item.toStringList().size();
-        break;
-      case TagLib::MP4::Item::Type::IntPair:
-        atomCount += 2;
-        break;
-      default:
-        atomCount++;
-        break;
-    }
-  }
-
-  if (atomCount == 0) {
-    char **empty = static_cast<char **>(malloc(sizeof(char *)));
-    if (empty) empty[0] = nullptr;
-    return empty;
-  }
-
-  char **atoms = static_cast<char **>(malloc(sizeof(char *) * (atomCount + 1)));
-  if (!atoms) return nullptr;
-
-  size_t i = 0;
   for (auto it = itemMap.begin(); it != itemMap.end(); ++it) {
-    TagLib::String key = it->first;
-    TagLib::MP4::Item item = it->second;
+    const TagLib::String &key = it->first;
+    const TagLib::MP4::Item &item = it->second;
 
     switch (item.type()) {
-      case TagLib::MP4::Item::Type::Bool: {
-        TagLib::String value = item.toBool() ? "1" : "0";
-        atoms[i++] = to_char_array(key + "\t" + value);
+      case TagLib::MP4::Item::Type::Bool:
+        out.row(key, item.toBool() ? "1" : "0");
         break;
-      }
-      case TagLib::MP4::Item::Type::Int: {
-        atoms[i++] = to_char_array(key + "\t" + TagLib::String::number(item.toInt()));
+      case TagLib::MP4::Item::Type::Int:
+        out.row(key, TagLib::String::number(item.toInt()));
         break;
-      }
       case TagLib::MP4::Item::Type::IntPair: {
+        // num and total as separate keys
         auto pair = item.toIntPair();
-        atoms[i++] = to_char_array(key + ":num\t" + TagLib::String::number(pair.first));
-        atoms[i++] = to_char_array(key + ":total\t" + TagLib::String::number(pair.second));
+        out.row(key + ":num", TagLib::String::number(pair.first));
+        out.row(key + ":total", TagLib::String::number(pair.second));
         break;
       }
-      case TagLib::MP4::Item::Type::Byte: {
-        atoms[i++] = to_char_array(key + "\t" + TagLib::String::number(item.toByte()));
+      case TagLib::MP4::Item::Type::Byte:
+        out.row(key, TagLib::String::number(item.toByte()));
         break;
-      }
-      case TagLib::MP4::Item::Type::UInt: {
-        atoms[i++] = to_char_array(key + "\t" + TagLib::String::number(item.toUInt()));
+      case TagLib::MP4::Item::Type::UInt:
+        out.row(key, TagLib::String::number(item.toUInt()));
         break;
-      }
-      case TagLib::MP4::Item::Type::LongLong: {
-        atoms[i++] = to_char_array(key + "\t" + TagLib::String::number(item.toLongLong()));
+      case TagLib::MP4::Item::Type::LongLong:
+        out.row(key, TagLib::String::number(item.toLongLong()));
         break;
-      }
-      case TagLib::MP4::Item::Type::StringList: {
-        for (const auto &s : item.toStringList()) {
-          atoms[i++] = to_char_array(key + "\t" + s);
-        }
+      case TagLib::MP4::Item::Type::StringList:
+        for (const auto &s : item.toStringList())
+          out.row(key, s);
         break;
-      }
       case TagLib::MP4::Item::Type::CoverArtList:
-      case TagLib::MP4::Item::Type::ByteVectorList: {
-        atoms[i++] = to_char_array(key + "\t");
+      case TagLib::MP4::Item::Type::ByteVectorList:
+        // Include binary data atoms with empty value (like ID3v2 does for APIC)
+        out.row(key, TagLib::String());
         break;
-      }
       default:
         break;
     }
   }
 
-  atoms[i] = nullptr;
-  return atoms;
+  return out.finish();
 }
 
-static char **read_asf_attributes_from_tag(TagLib::ASF::Tag *asfTag) {
-  if (!asfTag) {
-    char **empty = static_cast<char **>(malloc(sizeof(char *)));
-    if (empty) empty[0] = nullptr;
-    return empty;
-  }
-
-  const TagLib::ASF::AttributeListMap &attrMap = asfTag->attributeListMap();
-
-  size_t basicCount = 0;
-  if (!asfTag->title().isEmpty()) basicCount++;
-  if (!asfTag->artist().isEmpty()) basicCount++;
-  if (!asfTag->copyright().isEmpty()) basicCount++;
-  if (!asfTag->comment().isEmpty()) basicCount++;
-  if (!asfTag->rating().isEmpty()) basicCount++;
-
-  size_t attrCount = basicCount;
-  for (auto it = attrMap.begin(); it != attrMap.end(); ++it) {
-    attrCount += it->second.size();
-  }
-
-  if (attrCount == 0) {
-    char **empty = static_cast<char **>(malloc(sizeof(char *)));
-    if (empty) empty[0] = nullptr;
-    return empty;
-  }
-
-  char **attrs = static_cast<char **>(malloc(sizeof(char *) * (attrCount + 1)));
-  if (!attrs) return nullptr;
-
-  size_t i = 0;
+static char *read_asf_attributes_from_tag(TagLib::ASF::Tag *asfTag) {
+  ResultBuffer out;
+  if (!asfTag)
+    return out.finish();
 
+  // Add basic fields first (these are stored separately from the attributeListMap)
   if (!asfTag->title().isEmpty())
-    attrs[i++] = to_char_array(TagLib::String("Title\t") + asfTag->title());
+    out.row("Title", asfTag->title());
   if (!asfTag->artist().isEmpty())
-    attrs[i++] = to_char_array(TagLib::String("Author\t") + asfTag->artist());
+    out.row("Author", asfTag->artist());
   if (!asfTag->copyright().isEmpty())
-    attrs[i++] = to_char_array(TagLib::String("Copyright\t") + asfTag->copyright());
+    out.row("Copyright", asfTag->copyright());
   if (!asfTag->comment().isEmpty())
-    attrs[i++] = to_char_array(TagLib::String("Description\t") + asfTag->comment());
+    out.row("Description", asfTag->comment());
   if (!asfTag->rating().isEmpty())
-    attrs[i++] = to_char_array(TagLib::String("Rating\t") + asfTag->rating());
+    out.row("Rating", asfTag->rating());
 
+  // Add extended attributes
+  const TagLib::ASF::AttributeListMap &attrMap = asfTag->attributeListMap();
   for (auto it = attrMap.begin(); it != attrMap.end(); ++it) {
-    TagLib::String key = it->first;
+    const TagLib::String &key = it->first;
     for (const auto &attr : it->second) {
       TagLib::String value;
       switch (attr.type()) {
@@ -1040,520 +1897,366 @@ static char **read_asf_attributes_from_tag(TagLib::ASF::Tag *asfTag) {
           break;
         case TagLib::ASF::Attribute::BytesType:
         case TagLib::ASF::Attribute::GuidType:
-          value = "";
+          // Binary data - include with empty value (like ID3v2 does for APIC)
           break;
         default:
           continue;
       }
-      attrs[i++] = to_char_array(key + "\t" + value);
+      out.row(key, value);
     }
   }
 
-  attrs[i] = nullptr;
-  return attrs;
+  return out.finish();
+}
+
+static char *read_id3v1_tags_from_tag(TagLib::ID3v1::Tag *id3v1Tag) {
+  ResultBuffer out;
+  if (!id3v1Tag)
+    return out.finish();
+
+  // ID3v1 has a fixed set of fields: title, artist, album, year, comment, track, genre
+  if (!id3v1Tag->title().isEmpty())
+    out.row("TITLE", id3v1Tag->title());
+  if (!id3v1Tag->artist().isEmpty())
+    out.row("ARTIST", id3v1Tag->artist());
+  if (!id3v1Tag->album().isEmpty())
+    out.row("ALBUM", id3v1Tag->album());
+  if (id3v1Tag->year() > 0)
+    out.row("YEAR", TagLib::String::number(id3v1Tag->year()));
+  if (!id3v1Tag->comment().isEmpty())
+    out.row("COMMENT", id3v1Tag->comment());
+  if (id3v1Tag->track() > 0)
+    out.row("TRACK", TagLib::String::number(id3v1Tag->track()));
+  // Genre is an int in ID3v1, 255 is used for "unknown genre"
+  if (id3v1Tag->genreNumber() != 255 && !id3v1Tag->genre().isEmpty())
+    out.row("GENRE", id3v1Tag->genre());
+
+  return out.finish();
 }
 
 // ============================================================================
 // Path-based API (legacy)
 // ============================================================================
 
-__attribute__((export_name("taglib_file_tags"))) char **
-taglib_file_tags(const char *filename) {
-  TagLib::FileRef file(filename);
+static char *file_tags(const char *filename) {
+  TagLib::FileRef file(filename, false);
   if (file.isNull())
     return nullptr;
   return serialize_properties(enrich_matroska_properties(file));
 }
 
-__attribute__((export_name("taglib_file_write_tags"))) bool
-taglib_file_write_tags(const char *filename, const char **tags, uint8_t opts) {
+TAGLIB_EXPORT("taglib_file_tags") char *
+taglib_file_tags(const char *filename) {
+  g_arena.enter();
+  return file_tags(filename);
+}
+
+TAGLIB_EXPORT("taglib_file_tags_keys") char *
+taglib_file_tags_keys(const char *filename, guest_strings keys) {
+  g_arena.enter();
+  if (!keys)
+    return nullptr;
+  TagLib::FileRef file(filename, false);
+  if (file.isNull())
+    return nullptr;
+  return read_tags_keys(file, keys);
+}
+
+static ReadAllResult *file_read_all(const char *filename) {
+  TagLib::FileRef file(filename);
+  return read_all(file, detect_format(file.file()));
+}
+
+TAGLIB_EXPORT("taglib_file_read_all") ReadAllResult *
+taglib_file_read_all(const char *filename) {
+  g_arena.enter();
+  return file_read_all(filename);
+}
+
+// Batch variants of the path API take a null terminated array of filenames and return an
+// array with one result per file, null for a file that couldn't be read.
+template <typename T, typename Read>
+static guest_ptr<T> *read_batch(guest_strings filenames, Read read) {
+  if (!filenames)
+    return nullptr;
+
+  size_t count = 0;
+  while (filenames[count])
+    count++;
+
+  auto *results = static_cast<guest_ptr<T> *>(host_alloc(sizeof(guest_ptr<T>) * (count + 1)));
+  if (!results)
+    return nullptr;
+
+  for (size_t i = 0; i < count; i++)
+    results[i] = read(filenames[i]);
+  results[count] = nullptr;
+  return results;
+}
+
+TAGLIB_EXPORT("taglib_file_tags_batch") guest_ptr<char> *
+taglib_file_tags_batch(guest_strings filenames) {
+  g_arena.enter();
+  return read_batch<char>(filenames, file_tags);
+}
+
+TAGLIB_EXPORT("taglib_file_read_all_batch") guest_ptr<ReadAllResult> *
+taglib_file_read_all_batch(guest_strings filenames) {
+  g_arena.enter();
+  return read_batch<ReadAllResult>(filenames, file_read_all);
+}
+
+TAGLIB_EXPORT("taglib_file_write_tags") uint8_t
+taglib_file_write_tags(const char *filename, guest_strings tags, uint8_t opts) {
+  g_arena.enter();
   if (!filename)
-    return false;
+    return WRITE_FAILED;
   TagLib::FileRef file(filename);
   return write_tags(file, tags, opts);
 }
 
-__attribute__((export_name("taglib_file_read_properties"))) FileProperties *
+TAGLIB_EXPORT("taglib_file_read_properties") FileProperties *
 taglib_file_read_properties(const char *filename) {
+  g_arena.enter();
   TagLib::FileRef file(filename);
   return read_file_properties(file);
 }
 
-__attribute__((export_name("taglib_file_read_image"))) ByteData *
+TAGLIB_EXPORT("taglib_file_read_image") ByteData *
 taglib_file_read_image(const char *filename, int index) {
-  TagLib::FileRef file(filename);
+  g_arena.enter();
+  TagLib::FileRef file(filename, false);
   return read_image(file, index);
 }
 
-__attribute__((export_name("taglib_file_write_image"))) bool
+TAGLIB_EXPORT("taglib_file_write_image") uint8_t
 taglib_file_write_image(const char *filename, const char *buf, uint32_t length,
                         int index, const char *pictureType,
                         const char *description, const char *mimeType) {
+  g_arena.enter();
   TagLib::FileRef file(filename);
   return write_image(file, buf, length, index, pictureType, description, mimeType);
 }
 
-__attribute__((export_name("taglib_file_id3v2_frames"))) char **
+TAGLIB_EXPORT("taglib_file_id3v2_frames") char *
 taglib_file_id3v2_frames(const char *filename) {
+  g_arena.enter();
   // Check if file has ID3v2 tags (supports MP3, WAV, AIFF)
-  TagLib::FileRef fileRef(filename);
+  TagLib::FileRef fileRef(filename, false);
   if (fileRef.isNull())
     return nullptr;
 
-  TagLib::ID3v2::Tag *id3v2Tag = nullptr;
-
-  // Try MP3 first
-  if (TagLib::MPEG::File *mpegFile = dynamic_cast<TagLib::MPEG::File *>(fileRef.file())) {
-    if (mpegFile->hasID3v2Tag()) {
-      id3v2Tag = mpegFile->ID3v2Tag();
-    }
-  }
-  // Try WAV
-  else if (TagLib::RIFF::WAV::File *wavFile = dynamic_cast<TagLib::RIFF::WAV::File *>(fileRef.file())) {
-    if (wavFile->hasID3v2Tag()) {
-      id3v2Tag = wavFile->ID3v2Tag();
-    }
-  }
-  // Try AIFF
-  else if (TagLib::RIFF::AIFF::File *aiffFile = dynamic_cast<TagLib::RIFF::AIFF::File *>(fileRef.file())) {
-    if (aiffFile->hasID3v2Tag()) {
-      id3v2Tag = aiffFile->tag();
-    }
-  }
-
-  if (!id3v2Tag) {
-    // Return empty array instead of nullptr when there are no ID3v2 tags
-    char **emptyFrames = static_cast<char **>(malloc(sizeof(char *)));
-    if (!emptyFrames)
-      return nullptr;
-    emptyFrames[0] = nullptr;
-    return emptyFrames;
-  }
-  const TagLib::ID3v2::FrameListMap &frameListMap = id3v2Tag->frameListMap();
-
-  // Count total number of frames
-  size_t frameCount = 0;
-  for (TagLib::ID3v2::FrameListMap::ConstIterator it = frameListMap.begin(); it != frameListMap.end(); ++it) {
-    frameCount += it->second.size();
-  }
-
-  if (frameCount == 0) {
-    // Return empty array if there are no frames
-    char **emptyFrames = static_cast<char **>(malloc(sizeof(char *)));
-    if (!emptyFrames)
-      return nullptr;
-    emptyFrames[0] = nullptr;
-    return emptyFrames;
-  }
-
-  // Allocate result array
-  char **frames = static_cast<char **>(malloc(sizeof(char *) * (frameCount + 1)));
-  if (!frames)
-    return nullptr;
-
-  size_t i = 0;
-
-  // Process each frame
-  for (TagLib::ID3v2::FrameListMap::ConstIterator it = frameListMap.begin(); it != frameListMap.end(); ++it) {
-    TagLib::String frameID = TagLib::String(it->first);
-
-    for (TagLib::ID3v2::FrameList::ConstIterator frameIt = it->second.begin(); frameIt != it->second.end(); ++frameIt) {
-      TagLib::String key = frameID;
-      TagLib::String value;
-
-      // Handle special frame types
-      if (frameID == "TXXX") {
-        // User text identification frame
-        auto userFrame = dynamic_cast<TagLib::ID3v2::UserTextIdentificationFrame *>(*frameIt);
-        if (userFrame) {
-          key = frameID + ":" + userFrame->description();
-          if (!userFrame->fieldList().isEmpty()) {
-            value = userFrame->fieldList().back();
-          }
-        }
-      }
-      else if (frameID == "COMM") {
-        // Comments frame
-        auto commFrame = dynamic_cast<TagLib::ID3v2::CommentsFrame *>(*frameIt);
-        if (commFrame) {
-          key = frameID + ":" + commFrame->description();
-          value = commFrame->text();
-        }
-      }
-      else if (frameID == "POPM") {
-        // Popularimeter frame (used for WMP ratings)
-        auto popmFrame = dynamic_cast<TagLib::ID3v2::PopularimeterFrame *>(*frameIt);
-        if (popmFrame) {
-          key = frameID + ":" + popmFrame->email();
-          value = TagLib::String::number(popmFrame->rating());
-        }
-      }
-      else if (frameID == "USLT") {
-        // Unsynchronized lyrics frame
-        auto usltFrame = dynamic_cast<TagLib::ID3v2::UnsynchronizedLyricsFrame *>(*frameIt);
-        if (usltFrame) {
-          // Get language code (3 characters, e.g., "eng", "xxx")
-          TagLib::ByteVector lang = usltFrame->language();
-          TagLib::String langStr = "xxx";
-          if (lang.size() == 3) {
-            char langBuf[4] = {0};
-            memcpy(langBuf, lang.data(), 3);
-            langStr = TagLib::String(langBuf);
-          }
-          key = frameID + ":" + langStr;
-          value = usltFrame->text();
-        }
-      }
-      else if (frameID == "SYLT") {
-        // Synchronized lyrics frame - convert to LRC format
-        auto syltFrame = dynamic_cast<TagLib::ID3v2::SynchronizedLyricsFrame *>(*frameIt);
-        if (syltFrame) {
-          // Get language code (3 characters)
-          TagLib::ByteVector lang = syltFrame->language();
-          TagLib::String langStr = "xxx";
-          if (lang.size() == 3) {
-            char langBuf[4] = {0};
-            memcpy(langBuf, lang.data(), 3);
-            langStr = TagLib::String(langBuf);
-          }
-          key = frameID + ":" + langStr;
-
-          // Build LRC format from synchronized text
-          TagLib::String lrc;
-          auto format = syltFrame->timestampFormat();
-          for (const auto &syncText : syltFrame->synchedText()) {
-            int timeMs = syncText.time;
-            if (format == TagLib::ID3v2::SynchronizedLyricsFrame::AbsoluteMpegFrames) {
-              // Skip MPEG frames format - would need sample rate to convert
-              continue;
-            }
-            int mins = timeMs / 60000;
-            int secs = (timeMs % 60000) / 1000;
-            int centis = (timeMs % 1000) / 10;
-            char timeBuf[16];
-            snprintf(timeBuf, sizeof(timeBuf), "[%02d:%02d.%02d]", mins, secs, centis);
-            lrc = lrc + TagLib::String(timeBuf) + syncText.text + "\n";
-          }
-          value = lrc;
-        }
-      }
-      else {
-        // Standard frame
-        value = (*frameIt)->toString();
-      }
-
-      // Create the output string
-      TagLib::String row = key + "\t" + value;
-      frames[i++] = to_char_array(row);
-    }
-  }
-
-  frames[i] = nullptr;
-  return frames;
+  // Returns an empty result instead of nullptr when there are no ID3v2 tags
+  return read_id3v2_frames_from_tag(find_id3v2_tag(fileRef.file()));
 }
 
-__attribute__((export_name("taglib_file_id3v1_tags"))) char **
+TAGLIB_EXPORT("taglib_file_id3v1_tags") char *
 taglib_file_id3v1_tags(const char *filename) {
-  // First check if this is an MP3 file with ID3v1 tags
-  TagLib::FileRef fileRef(filename);
+  g_arena.enter();
+  TagLib::FileRef fileRef(filename, false);
   if (fileRef.isNull())
     return nullptr;
 
-  // Try to cast to MPEG::File
+  // Returns an empty result instead of nullptr when there are no ID3v1 tags
   TagLib::MPEG::File *mpegFile = dynamic_cast<TagLib::MPEG::File *>(fileRef.file());
-  if (!mpegFile || !mpegFile->hasID3v1Tag()) {
-    // Return empty array instead of nullptr when there are no ID3v1 tags
-    char **emptyTags = static_cast<char **>(malloc(sizeof(char *)));
-    if (!emptyTags)
-      return nullptr;
-    emptyTags[0] = nullptr;
-    return emptyTags;
-  }
-
-  TagLib::ID3v1::Tag *id3v1Tag = mpegFile->ID3v1Tag();
-
-  // ID3v1 has a fixed set of fields
-  const int fieldCount = 7; // title, artist, album, year, comment, track, genre
-  char **tags = static_cast<char **>(malloc(sizeof(char *) * (fieldCount + 1)));
-  if (!tags)
-    return nullptr;
-
-  int i = 0;
-
-  // Add each standard ID3v1 field
-  if (!id3v1Tag->title().isEmpty())
-    tags[i++] = to_char_array(TagLib::String("TITLE\t") + id3v1Tag->title());
-
-  if (!id3v1Tag->artist().isEmpty())
-    tags[i++] = to_char_array(TagLib::String("ARTIST\t") + id3v1Tag->artist());
-
-  if (!id3v1Tag->album().isEmpty())
-    tags[i++] = to_char_array(TagLib::String("ALBUM\t") + id3v1Tag->album());
-
-  // Year is an unsigned int in ID3v1, convert to string
-  if (id3v1Tag->year() > 0)
-    tags[i++] = to_char_array(TagLib::String("YEAR\t") + TagLib::String::number(id3v1Tag->year()));
-
-  if (!id3v1Tag->comment().isEmpty())
-    tags[i++] = to_char_array(TagLib::String("COMMENT\t") + id3v1Tag->comment());
-
-  if (id3v1Tag->track() > 0)
-    tags[i++] = to_char_array(TagLib::String("TRACK\t") + TagLib::String::number(id3v1Tag->track()));
-
-  // Genre is an int in ID3v1, need to get the string representation
-  if (id3v1Tag->genreNumber() != 255) { // 255 is used for "unknown genre"
-    if (!id3v1Tag->genre().isEmpty())
-      tags[i++] = to_char_array(TagLib::String("GENRE\t") + id3v1Tag->genre());
-  }
-
-  tags[i] = nullptr;
-  return tags;
+  if (!mpegFile || !mpegFile->hasID3v1Tag())
+    return read_id3v1_tags_from_tag(nullptr);
+  return read_id3v1_tags_from_tag(mpegFile->ID3v1Tag());
 }
 
-__attribute__((export_name("taglib_file_mp4_atoms"))) char **
+TAGLIB_EXPORT("taglib_file_mp4_atoms") char *
 taglib_file_mp4_atoms(const char *filename) {
-  TagLib::FileRef fileRef(filename);
+  g_arena.enter();
+  TagLib::FileRef fileRef(filename, false);
   if (fileRef.isNull())
     return nullptr;
 
-  // Try to cast to MP4::File
+  // Returns an empty result instead of nullptr when there are no MP4 atoms
   TagLib::MP4::File *mp4File = dynamic_cast<TagLib::MP4::File *>(fileRef.file());
-  if (!mp4File || !mp4File->hasMP4Tag()) {
-    // Return empty array instead of nullptr when there are no MP4 atoms
-    char **emptyAtoms = static_cast<char **>(malloc(sizeof(char *)));
-    if (!emptyAtoms)
-      return nullptr;
-    emptyAtoms[0] = nullptr;
-    return emptyAtoms;
-  }
-
-  TagLib::MP4::Tag *mp4Tag = mp4File->tag();
-  const TagLib::MP4::ItemMap &itemMap = mp4Tag->itemMap();
-
-  // First pass: count total entries (multi-value items count as multiple)
-  size_t atomCount = 0;
-  for (auto it = itemMap.begin(); it != itemMap.end(); ++it) {
-    TagLib::MP4::Item item = it->second;
-    switch (item.type()) {
-      case TagLib::MP4::Item::Type::StringList:
-        atomCount += item.toStringList().size();
-        break;
-      case TagLib::MP4::Item::Type::IntPair:
-        atomCount += 2; // num and total as separate keys
-        break;
-      default:
-        atomCount++;
-        break;
-    }
-  }
-
-  if (atomCount == 0) {
-    char **emptyAtoms = static_cast<char **>(malloc(sizeof(char *)));
-    if (!emptyAtoms)
-      return nullptr;
-    emptyAtoms[0] = nullptr;
-    return emptyAtoms;
-  }
-
-  char **atoms = static_cast<char **>(malloc(sizeof(char *) * (atomCount + 1)));
-  if (!atoms)
-    return nullptr;
-
-  size_t i = 0;
-  for (auto it = itemMap.begin(); it != itemMap.end(); ++it) {
-    TagLib::String key = it->first;
-    TagLib::MP4::Item item = it->second;
-
-    switch (item.type()) {
-      case TagLib::MP4::Item::Type::Bool: {
-        TagLib::String value = item.toBool() ? "1" : "0";
-        TagLib::String row = key + "\t" + value;
-        atoms[i++] = to_char_array(row);
-        break;
-      }
-      case TagLib::MP4::Item::Type::Int: {
-        TagLib::String value = TagLib::String::number(item.toInt());
-        TagLib::String row = key + "\t" + value;
-        atoms[i++] = to_char_array(row);
-        break;
-      }
-      case TagLib::MP4::Item::Type::IntPair: {
-        auto pair = item.toIntPair();
-        TagLib::String numRow = key + ":num\t" + TagLib::String::number(pair.first);
-        TagLib::String totalRow = key + ":total\t" + TagLib::String::number(pair.second);
-        atoms[i++] = to_char_array(numRow);
-        atoms[i++] = to_char_array(totalRow);
-        break;
-      }
-      case TagLib::MP4::Item::Type::Byte: {
-        TagLib::String value = TagLib::String::number(item.toByte());
-        TagLib::String row = key + "\t" + value;
-        atoms[i++] = to_char_array(row);
-        break;
-      }
-      case TagLib::MP4::Item::Type::UInt: {
-        TagLib::String value = TagLib::String::number(item.toUInt());
-        TagLib::String row = key + "\t" + value;
-        atoms[i++] = to_char_array(row);
-        break;
-      }
-      case TagLib::MP4::Item::Type::LongLong: {
-        TagLib::String value = TagLib::String::number(item.toLongLong());
-        TagLib::String row = key + "\t" + value;
-        atoms[i++] = to_char_array(row);
-        break;
-      }
-      case TagLib::MP4::Item::Type::StringList: {
-        TagLib::StringList sl = item.toStringList();
-        for (const auto &s : sl) {
-          TagLib::String row = key + "\t" + s;
-          atoms[i++] = to_char_array(row);
-        }
-        break;
-      }
-      case TagLib::MP4::Item::Type::CoverArtList:
-      case TagLib::MP4::Item::Type::ByteVectorList: {
-        // Include binary data atoms with empty value (like ID3v2 does for APIC)
-        TagLib::String row = key + "\t";
-        atoms[i++] = to_char_array(row);
-        break;
-      }
-      default:
-        break;
-    }
-  }
-
-  atoms[i] = nullptr;
-  return atoms;
+  if (!mp4File || !mp4File->hasMP4Tag())
+    return read_mp4_items_from_tag(nullptr);
+  return read_mp4_items_from_tag(mp4File->tag());
 }
 
-__attribute__((export_name("taglib_file_asf_attributes"))) char **
+TAGLIB_EXPORT("taglib_file_asf_attributes") char *
 taglib_file_asf_attributes(const char *filename) {
-  TagLib::FileRef fileRef(filename);
+  g_arena.enter();
+  TagLib::FileRef fileRef(filename, false);
   if (fileRef.isNull())
     return nullptr;
 
-  // Try to cast to ASF::File
+  // Returns an empty result instead of nullptr when there are no ASF attributes
   TagLib::ASF::File *asfFile = dynamic_cast<TagLib::ASF::File *>(fileRef.file());
-  if (!asfFile || !asfFile->tag()) {
-    // Return empty array instead of nullptr when there are no ASF attributes
-    char **emptyAttrs = static_cast<char **>(malloc(sizeof(char *)));
-    if (!emptyAttrs)
-      return nullptr;
-    emptyAttrs[0] = nullptr;
-    return emptyAttrs;
-  }
-
-  TagLib::ASF::Tag *asfTag = asfFile->tag();
-  const TagLib::ASF::AttributeListMap &attrMap = asfTag->attributeListMap();
-
-  // Count basic fields (Title, Author, Copyright, Description, Rating)
-  size_t basicCount = 0;
-  if (!asfTag->title().isEmpty()) basicCount++;
-  if (!asfTag->artist().isEmpty()) basicCount++;
-  if (!asfTag->copyright().isEmpty()) basicCount++;
-  if (!asfTag->comment().isEmpty()) basicCount++;
-  if (!asfTag->rating().isEmpty()) basicCount++;
+  if (!asfFile)
+    return read_asf_attributes_from_tag(nullptr);
+  return read_asf_attributes_from_tag(asfFile->tag());
+}
 
-  // Count total entries (multi-value attributes count as multiple)
-  size_t attrCount = basicCount;
-  for (auto it = attrMap.begin(); it != attrMap.end(); ++it) {
-    attrCount += it->second.size();
+// FNV-1a hash of the tag regions of a file, see tag_fingerprint
+class Fingerprint {
+public:
+  void add(const TagLib::ByteVector &data) {
+    for (char c : data) {
+      m_hash ^= static_cast<uint8_t>(c);
+      m_hash *= 1099511628211ULL;
+    }
+    m_regions++;
   }
 
-  if (attrCount == 0) {
-    char **emptyAttrs = static_cast<char **>(malloc(sizeof(char *)));
-    if (!emptyAttrs)
-      return nullptr;
-    emptyAttrs[0] = nullptr;
-    return emptyAttrs;
+  void add(uint64_t n) {
+    for (int i = 0; i < 8; i++) {
+      m_hash ^= static_cast<uint8_t>(n >> (i * 8));
+      m_hash *= 1099511628211ULL;
+    }
   }
 
-  char **attrs = static_cast<char **>(malloc(sizeof(char *) * (attrCount + 1)));
-  if (!attrs)
-    return nullptr;
+  // 0 if no tag region was found, so the caller can tell it apart from a real hash
+  uint64_t value() const { return m_regions ? (m_hash ? m_hash : 1) : 0; }
 
-  size_t i = 0;
+private:
+  uint64_t m_hash = 14695981039346656037ULL;
+  uint32_t m_regions = 0;
+};
 
-  // Add basic fields first (these are stored separately from the attributeListMap)
-  if (!asfTag->title().isEmpty()) {
-    TagLib::String row = TagLib::String("Title\t") + asfTag->title();
-    attrs[i++] = to_char_array(row);
-  }
-  if (!asfTag->artist().isEmpty()) {
-    TagLib::String row = TagLib::String("Author\t") + asfTag->artist();
-    attrs[i++] = to_char_array(row);
-  }
-  if (!asfTag->copyright().isEmpty()) {
-    TagLib::String row = TagLib::String("Copyright\t") + asfTag->copyright();
-    attrs[i++] = to_char_array(row);
-  }
-  if (!asfTag->comment().isEmpty()) {
-    TagLib::String row = TagLib::String("Description\t") + asfTag->comment();
-    attrs[i++] = to_char_array(row);
-  }
-  if (!asfTag->rating().isEmpty()) {
-    TagLib::String row = TagLib::String("Rating\t") + asfTag->rating();
-    attrs[i++] = to_char_array(row);
-  }
+// Hashes the regions of a file's raw bytes that hold tags, without parsing them or reading
+// the audio: leading ID3v2, FLAC metadata blocks besides padding, MP4 moov/udta, Ogg header
+// pages, RIFF and AIFF chunks besides audio data, the ASF header object, and trailing APEv2
+// and ID3v1. The file length is hashed too. Returns 0 if the format has none of them.
+static uint64_t tag_fingerprint(TagLib::IOStream *stream) {
+  const TagLib::offset_t length = stream->length();
+  auto read = [&](TagLib::offset_t at, TagLib::offset_t n) {
+    if (at < 0 || at >= length)
+      return TagLib::ByteVector();
+    stream->seek(at);
+    return stream->readBlock(static_cast<size_t>(std::min(n, length - at)));
+  };
 
-  // Add extended attributes
-  for (auto it = attrMap.begin(); it != attrMap.end(); ++it) {
-    TagLib::String key = it->first;
-    const TagLib::ASF::AttributeList &attrList = it->second;
+  Fingerprint fp;
+  fp.add(static_cast<uint64_t>(length));
+
+  TagLib::offset_t pos = 0;
+  const TagLib::ByteVector id3 = read(0, 10);
+  if (id3.size() == 10 && id3.startsWith("ID3")) {
+    TagLib::offset_t size = 10 + ((id3[6] & 0x7f) << 21 | (id3[7] & 0x7f) << 14 |
+                                  (id3[8] & 0x7f) << 7 | (id3[9] & 0x7f));
+    if (id3[5] & 0x10)
+      size += 10; // footer
+    fp.add(read(0, size));
+    pos = size;
+  }
 
-    for (const auto &attr : attrList) {
-      TagLib::String value;
-      switch (attr.type()) {
-        case TagLib::ASF::Attribute::UnicodeType:
-          value = attr.toString();
-          break;
-        case TagLib::ASF::Attribute::BoolType:
-          value = attr.toBool() ? "1" : "0";
-          break;
-        case TagLib::ASF::Attribute::DWordType:
-          value = TagLib::String::number(attr.toUInt());
-          break;
-        case TagLib::ASF::Attribute::QWordType:
-          value = TagLib::String::number(static_cast<long long>(attr.toULongLong()));
-          break;
-        case TagLib::ASF::Attribute::WordType:
-          value = TagLib::String::number(attr.toUShort());
-          break;
-        case TagLib::ASF::Attribute::BytesType:
-        case TagLib::ASF::Attribute::GuidType:
-          // Binary data - include with empty value (like ID3v2 does for APIC)
-          value = "";
-          break;
-        default:
-          continue;
+  const TagLib::ByteVector magic = read(pos, 16);
+  static const TagLib::ByteVector asfGuid("\x30\x26\xb2\x75\x8e\x66\xcf\x11\xa6\xd9\x00\xaa\x00\x62\xce\x6c", 16);
+  if (magic.startsWith("fLaC")) {
+    for (TagLib::offset_t p = pos + 4; p < length;) {
+      const TagLib::ByteVector header = read(p, 4);
+      if (header.size() < 4) break;
+      const TagLib::offset_t blockSize = 4 + header.toUInt(1, 3, true);
+      fp.add((header[0] & 0x7f) == 1 ? header : read(p, blockSize)); // padding only by size
+      p += blockSize;
+      if (header[0] & 0x80) break; // last block
+    }
+  } else if (magic.containsAt("ftyp", 4)) {
+    // Top level atoms, then the children of moov
+    for (TagLib::offset_t p = pos, end = length; p + 8 <= end;) {
+      const TagLib::ByteVector header = read(p, 16);
+      if (header.size() < 8) break;
+      TagLib::offset_t atomSize = header.toUInt(0, 4, true);
+      TagLib::offset_t headerSize = 8;
+      if (atomSize == 1 && header.size() == 16) {
+        atomSize = header.toLongLong(8, true);
+        headerSize = 16;
+      } else if (atomSize == 0) {
+        atomSize = end - p;
       }
-
-      TagLib::String row = key + "\t" + value;
-      attrs[i++] = to_char_array(row);
+      if (atomSize < headerSize) break;
+      const TagLib::ByteVector name = header.mid(4, 4);
+      if (name == "moov") {
+        end = p + atomSize;
+        p += headerSize;
+        continue;
+      }
+      if (name == "udta")
+        fp.add(read(p, atomSize));
+      p += atomSize;
+    }
+  } else if (magic.startsWith("OggS")) {
+    // Header pages have a granule position of 0, or -1 when no packet ends on them, like the
+    // continuations of a comment packet holding a large picture. The first audio page ends them.
+    for (TagLib::offset_t p = pos; p < length;) {
+      const TagLib::ByteVector header = read(p, 27);
+      if (header.size() < 27 || !header.startsWith("OggS")) break;
+      const long long granule = header.toLongLong(6, false);
+      if (granule != 0 && granule != -1) break;
+      const TagLib::ByteVector segments = read(p + 27, static_cast<uint8_t>(header[26]));
+      TagLib::offset_t pageSize = 27 + segments.size();
+      for (char c : segments)
+        pageSize += static_cast<uint8_t>(c);
+      fp.add(read(p, pageSize));
+      p += pageSize;
+    }
+  } else if (magic.startsWith("RIFF") || magic.startsWith("FORM")) {
+    const bool littleEndian = magic.startsWith("RIFF");
+    for (TagLib::offset_t p = pos + 12; p + 8 <= length;) {
+      const TagLib::ByteVector header = read(p, 8);
+      if (header.size() < 8) break;
+      const TagLib::offset_t chunkSize = 8 + header.toUInt(4, 4, !littleEndian);
+      const TagLib::ByteVector id = header.mid(0, 4);
+      fp.add(id == "data" || id == "SSND" ? header : read(p, chunkSize)); // audio only by size
+      p += chunkSize + (chunkSize & 1);
     }
+  } else if (magic.startsWith(asfGuid)) {
+    const TagLib::ByteVector header = read(pos + 16, 8);
+    if (header.size() == 8)
+      fp.add(read(pos, header.toLongLong(0, false)));
+  }
+
+  TagLib::offset_t end = length;
+  const TagLib::ByteVector id3v1 = read(length - 128, 3);
+  if (length >= 128 && id3v1 == "TAG") {
+    fp.add(read(length - 128, 128));
+    end -= 128;
+  }
+  const TagLib::ByteVector apeFooter = read(end - 32, 32);
+  if (end >= 32 && apeFooter.startsWith("APETAGEX")) {
+    // The size covers the items and footer, plus a header if flagged
+    TagLib::offset_t size = apeFooter.toUInt(12, 4, false);
+    if (apeFooter.toUInt(20, 4, false) & 0x80000000)
+      size += 32;
+    fp.add(read(end - size, size));
   }
 
-  attrs[i] = nullptr;
-  return attrs;
+  return fp.value();
 }
 
-__attribute__((export_name("taglib_file_write_id3v2_frames"))) bool
-taglib_file_write_id3v2_frames(const char *filename, const char **frames, uint8_t opts) {
-  if (!filename || !frames)
-    return false;
+static uint64_t file_tag_fingerprint(const char *filename) {
+  TagLib::FileStream stream(filename, true);
+  if (!stream.isOpen())
+    return 0;
+  return tag_fingerprint(&stream);
+}
 
-  // First check if this is an MP3 file with ID3v2 tags
-  TagLib::MPEG::File file(filename);
-  if (!file.isValid())
-    return false;
+TAGLIB_EXPORT("taglib_file_tag_fingerprint") uint64_t
+taglib_file_tag_fingerprint(const char *filename) {
+  g_arena.enter();
+  return file_tag_fingerprint(filename);
+}
 
-  // Create a new ID3v2 tag if one doesn't exist
-  if (!file.hasID3v2Tag()) {
-    file.ID3v2Tag(true);
-  }
+TAGLIB_EXPORT("taglib_handle_tag_fingerprint") uint64_t
+taglib_handle_tag_fingerprint(uint32_t handle) {
+  g_arena.enter();
+  FileHandle *h = g_handles.get(handle);
+  if (!h)
+    return 0;
+  if (h->stream)
+    return tag_fingerprint(h->goStream());
+  return file_tag_fingerprint(h->filename.c_str());
+}
 
-  TagLib::ID3v2::Tag *id3v2Tag = file.ID3v2Tag();
+// Applies ID3v2 frame changes to id3v2Tag in memory, without saving the file. Sets changed
+// if the tag renders differently afterwards.
+static void apply_id3v2_frames(TagLib::ID3v2::Tag *id3v2Tag, guest_strings frames, uint8_t opts, bool &changed) {
+  const TagLib::ByteVector before = id3v2Tag->render();
 
   // If clear option is set, collect all frame IDs we want to keep
   bool clearFrames = (opts & CLEAR);
@@ -1636,6 +2339,158 @@ taglib_file_write_id3v2_frames(const char *filename, const char **frames, uint8_
     }
   }
 
+  if (id3v2Tag->render() != before)
+    changed = true;
+}
+
+TAGLIB_EXPORT("taglib_file_write_id3v2_frames") uint8_t
+taglib_file_write_id3v2_frames(const char *filename, guest_strings frames, uint8_t opts) {
+  g_arena.enter();
+  if (!filename || !frames)
+    return WRITE_FAILED;
+
+  // First check if this is an MP3 file with ID3v2 tags
+  TagLib::MPEG::File file(filename);
+  if (!file.isValid())
+    return WRITE_FAILED;
+
+  // Create a new ID3v2 tag if one doesn't exist
+  if (!file.hasID3v2Tag()) {
+    file.ID3v2Tag(true);
+  }
+
+  bool changed = false;
+  apply_id3v2_frames(file.ID3v2Tag(), frames, opts, changed);
+  if (!changed)
+    return WRITE_UNCHANGED;
+
   // Save the file
-  return file.save();
+  return save_file(&file);
+}
+
+// Key of the placeholder used to grow a tag by the requested padding
+static const char *PADDING_KEY = "GOTAGLIB_PADDING";
+
+// Most padding TagLib keeps, on large files. Must match Go's maxPadding
+static const uint32_t MAX_PADDING = 1 << 20;
+
+// Saves file so that its tag is left with at least padding bytes of free space, when the format
+// keeps the space a shrinking tag frees:
+// ID3v2 and FLAC keep it as padding, MP4 as a free atom. This is done by saving once
+// with a placeholder of that size and again without it. The second save always fits in place,
+// so the file is only rewritten once even when the tag outgrew its old padding.
+// TagLib drops padding larger than 1% of the file (min 1KiB, max 1MiB) on ID3v2 and FLAC,
+// so larger reserves are capped at MAX_PADDING before the placeholder is built. Other formats
+// are saved normally.
+//
+// If the second save fails, it's tried once more. Should that fail too, the file is left with
+// the placeholder in its tag, which is reported as WRITE_PADDING_LEFT.
+static uint8_t save_with_padding(TagLib::File *file, uint32_t padding, GoIOStream *stream) {
+  if (padding == 0)
+    return save_file(file, stream);
+  padding = std::min(padding, MAX_PADDING);
+
+  const auto before = file->length();
+  const TagLib::String placeholder(std::string(padding, ' '), TagLib::String::UTF8);
+  bool saved;
+  if (auto *mpegFile = dynamic_cast<TagLib::MPEG::File *>(file)) {
+    auto *tag = mpegFile->ID3v2Tag(true);
+    auto *frame = new TagLib::ID3v2::UserTextIdentificationFrame(TagLib::String::UTF8);
+    frame->setDescription(PADDING_KEY);
+    frame->setText(placeholder);
+    tag->addFrame(frame);
+    saved = save_file(file, stream) != WRITE_FAILED;
+    tag->removeFrame(frame);
+  } else if (auto *flacFile = dynamic_cast<TagLib::FLAC::File *>(file)) {
+    auto *tag = flacFile->xiphComment(true);
+    tag->addField(PADDING_KEY, placeholder);
+    saved = save_file(file, stream) != WRITE_FAILED;
+    tag->removeFields(PADDING_KEY);
+  } else if (auto *mp4File = dynamic_cast<TagLib::MP4::File *>(file)) {
+    const TagLib::String key = TagLib::String("----:com.apple.iTunes:") + PADDING_KEY;
+    auto *tag = mp4File->tag();
+    tag->setItem(key, TagLib::StringList(placeholder));
+    saved = save_file(file, stream) != WRITE_FAILED;
+    tag->removeItem(key);
+  } else {
+    return save_file(file, stream);
+  }
+
+  if (!saved)
+    return WRITE_FAILED;
+  if (save_file(file, stream) == WRITE_FAILED && save_file(file, stream) == WRITE_FAILED)
+    return WRITE_PADDING_LEFT;
+  return file->length() == before ? WRITE_SAVED_IN_PLACE : WRITE_SAVED;
+}
+
+// Reads a little endian u32 from a possibly unaligned buffer and advances past it
+static uint32_t read_u32(const char *&p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  p += sizeof(v);
+  return v;
+}
+
+// Reads a [u32 length][length bytes] UTF-8 field and advances past it
+static TagLib::String read_field(const char *&p) {
+  uint32_t length = read_u32(p);
+  TagLib::String s(TagLib::ByteVector(p, length), TagLib::String::UTF8);
+  p += length;
+  return s;
+}
+
+// Applies tag, ID3v2 frame and picture changes to a file in that order, then saves it once,
+// unless none of them changed anything. Any of tags, id3v2Frames and pictureOps can be null to
+// leave that part alone.
+//
+// pictureOps is [u32 count], then for each edit [i32 index][u32 length][length bytes of data]
+// followed by pictureType, description and mimeType fields. The edits are applied in order
+// with the same rules as taglib_handle_write_image.
+//
+// A non zero padding makes the save leave that much free space in the tag, see
+// save_with_padding, so later writes can be done in place.
+TAGLIB_EXPORT("taglib_handle_apply") uint8_t
+taglib_handle_apply(uint32_t handle, guest_strings tags, uint8_t tagOpts,
+                    guest_strings id3v2Frames, uint8_t frameOpts, const char *pictureOps,
+                    uint32_t padding) {
+  g_arena.enter();
+  TagLib::FileRef *fileRef = get_file_ref(handle);
+  if (!fileRef || fileRef->isNull())
+    return WRITE_FAILED;
+
+  bool changed = false;
+  if (tags && !apply_tags(*fileRef, tags, tagOpts, changed))
+    return WRITE_FAILED;
+
+  if (id3v2Frames) {
+    auto *mpegFile = dynamic_cast<TagLib::MPEG::File *>(fileRef->file());
+    if (!mpegFile)
+      return WRITE_FAILED;
+    apply_id3v2_frames(mpegFile->ID3v2Tag(true), id3v2Frames, frameOpts, changed);
+  }
+
+  if (pictureOps) {
+    const char *p = pictureOps;
+    uint32_t count = read_u32(p);
+    if (count > 0) {
+      const auto current = fileRef->complexProperties("PICTURE");
+      auto pictures = current;
+      for (uint32_t i = 0; i < count; i++) {
+        int32_t index = static_cast<int32_t>(read_u32(p));
+        uint32_t length = read_u32(p);
+        const char *data = p;
+        p += length;
+        TagLib::String pictureType = read_field(p);
+        TagLib::String description = read_field(p);
+        TagLib::String mimeType = read_field(p);
+        edit_pictures(pictures, data, length, index, pictureType, description, mimeType);
+      }
+      if (!apply_pictures(*fileRef, current, pictures, changed))
+        return WRITE_FAILED;
+    }
+  }
+
+  if (!changed)
+    return WRITE_UNCHANGED;
+  return save_with_padding(fileRef->file(), padding, get_stream(handle));
 }
\ No newline at end of file
@@ -1,28 +1,27 @@
 package taglib
 
 import (
+	"bufio"
 	"bytes"
 	"context"
-	_ "embed"
+	"encoding/json"
+	"errors"
 	"fmt"
 	"io"
+	"io/fs"
 	"os"
 	"path/filepath"
+	"runtime"
+	"slices"
 	"strings"
 	"sync"
+	"sync/atomic"
 	"time"
-
-	"github.com/tetratelabs/wazero"
-	"github.com/tetratelabs/wazero/api"
-	"github.com/tetratelabs/wazero/imports/wasi_snapshot_preview1"
 )
 
-//go:embed taglib.wasm
-var binary []byte // WASM blob. To override, go build -ldflags="-X 'go.senan.xyz/taglib.binaryPath=/path/to/taglib.wasm'"
-var binaryPath string
-
 var ErrInvalidFile = fmt.Errorf("invalid file")
 var ErrSavingFile = fmt.Errorf("can't save file")
+var ErrMemoryLimit = fmt.Errorf("module memory limit reached")
 
 // Version returns the version of the embedded TagLib library (e.g., "2.2.1").
 func Version() string {
@@ -34,7 +33,7 @@ var getVersionOnce = sync.OnceValue(func() string {
 	if err != nil {
 		return "unknown"
 	}
-	defer mod.close()
+	defer mod.release()
 
 	var version wasmString
 	if err := mod.call("taglib_version", &version); err != nil {
@@ -43,6 +42,168 @@ var getVersionOnce = sync.OnceValue(func() string {
 	return string(version)
 })
 
+// Option configures package-wide behaviour. See [Configure].
+type Option func(*config)
+
+type config struct {
+	poolSize         int
+	cacheDir         string
+	metrics          Metrics
+	memoryLimitPages uint32
+	recyclePages     uint32
+}
+
+var (
+	cfg   = config{poolSize: runtime.GOMAXPROCS(0), cacheDir: filepath.Join(os.TempDir(), "go-taglib-wasm")}
+	cfgMu sync.RWMutex
+)
+
+func getConfig() config {
+	cfgMu.RLock()
+	defer cfgMu.RUnlock()
+	return cfg
+}
+
+// WithPoolSize sets how many initialised module instances are kept for reuse, per kind of
+// filesystem access. Calls beyond this many at once still work, but instantiate a module of
+// their own which is closed afterwards. Use 0 to disable pooling.
+// Default is [runtime.GOMAXPROCS].
+func WithPoolSize(n int) Option {
+	return func(c *config) {
+		c.poolSize = max(n, 0)
+	}
+}
+
+// WithCacheDir sets the directory where the compiled module is cached, so only the first
+// process to use a directory pays for compiling it. Point it at a directory filled by
+// [Precompile] at build or deploy time to skip compiling at startup. Use "" to disable the
+// on-disk cache. It must be set before the module is first used, later changes have no effect.
+// Default is go-taglib-wasm in [os.TempDir].
+func WithCacheDir(dir string) Option {
+	return func(c *config) {
+		c.cacheDir = dir
+	}
+}
+
+// WithMemoryLimitPages caps the memory of each module instance at pages 64 KiB pages. A call
+// that needs more, for example for a file with a huge embedded image, fails with
+// [ErrMemoryLimit], and the instance is replaced. It must be set before the module is first
+// used, later changes have no effect. Default is 0, for the 4 GiB that Wasm allows.
+func WithMemoryLimitPages(pages uint32) Option {
+	return func(c *config) {
+		c.memoryLimitPages = min(pages, 65536)
+	}
+}
+
+// WithRecyclePages closes module instances whose memory grew past pages 64 KiB pages when
+// they're released, instead of pooling them. Wasm memory never shrinks, so without it one
+// large file leaves its instance holding that much for as long as it's pooled. Default is 0,
+// which keeps every instance.
+func WithRecyclePages(pages uint32) Option {
+	return func(c *config) {
+		c.recyclePages = pages
+	}
+}
+
+// Precompile compiles the module into a cache in dir, for later use with [WithCacheDir].
+// The cache is only valid for the same build of this package, wazero version and platform,
+// so run it with the binary that will load it, for example as a step of building the image.
+func Precompile(dir string) error {
+	return precompile(dir)
+}
+
+// WithMetrics sets m to receive timings and counters from calls into the module and the
+// host I/O they do. Use nil to turn it off again. Default is nil, which costs one atomic load
+// per call.
+func WithMetrics(m Metrics) Option {
+	return func(c *config) {
+		c.metrics = m
+	}
+}
+
+// Metrics receives events from the hot paths of the package, to attribute latency to
+// formats, files or storage. Methods are called synchronously on the goroutine doing the
+// work, possibly from many goroutines at once, so they must be cheap and safe for
+// concurrent use. Set it with [WithMetrics].
+type Metrics interface {
+	// Instantiate is called after creating a module instance, which happens when the pool
+	// has no idle instance to lease
+	Instantiate(d time.Duration, err error)
+	// Call is called after each call into the module
+	Call(info CallInfo)
+	// HostIO is called after each read or write the module asks of a stream, and each read
+	// made to detect the format of a stream
+	HostIO(info HostIOInfo)
+}
+
+// CallInfo describes a call into the module, for [Metrics].
+type CallInfo struct {
+	// Export is the name of the function called, such as "taglib_handle_tags"
+	Export string
+	// Format is the format of the open [File] the call was made on, or [FormatUnknown]
+	// for calls that open a file or work on a path
+	Format FileFormat
+	// Duration is how long the call took
+	Duration time.Duration
+	// MemoryPages is the number of 64 KiB pages of linear memory after the call
+	MemoryPages uint32
+	// Err is the error the call failed with, if any
+	Err error
+}
+
+// HostIOOp is the kind of a host I/O operation.
+type HostIOOp uint8
+
+const (
+	HostRead     HostIOOp = iota // sequential read of an [OpenStream] reader
+	HostReadAt                   // read of an [OpenReaderAt] reader
+	HostWrite                    // write to a writable stream
+	HostTruncate                 // truncate of a writable stream
+)
+
+// HostIOInfo describes a read or write the module asked of a stream, for [Metrics].
+type HostIOInfo struct {
+	Op HostIOOp
+	// Bytes is the number of bytes read or written, or the new size for [HostTruncate]
+	Bytes int64
+	// Duration is how long the reader or writer took
+	Duration time.Duration
+}
+
+type metricsBox struct{ Metrics }
+
+// activeMetrics holds the configured Metrics where the hot paths can load it without a lock
+var activeMetrics atomic.Pointer[metricsBox]
+
+func getMetrics() Metrics {
+	if b := activeMetrics.Load(); b != nil {
+		return b.Metrics
+	}
+	return nil
+}
+
+// Configure applies package-wide options. It's safe to call at any time, including while
+// other calls are in progress.
+func Configure(opts ...Option) {
+	cfgMu.Lock()
+	for _, opt := range opts {
+		opt(&cfg)
+	}
+	size := cfg.poolSize
+	if cfg.metrics != nil {
+		activeMetrics.Store(&metricsBox{cfg.metrics})
+	} else {
+		activeMetrics.Store(nil)
+	}
+	cfgMu.Unlock()
+
+	poolsMu.Lock()
+	defer poolsMu.Unlock()
+	for _, p := range pools {
+		p.trim(size)
+	}
+}
+
 // FileFormat represents the detected audio file format.
 type FileFormat uint8
 
@@ -112,6 +273,130 @@ func (f FileFormat) String() string {
 	}
 }
 
+// DetectFormat identifies the format of the audio file at path from its magic bytes, reading
+// only the start of the file and skipping a leading ID3v2 tag. It doesn't start TagLib, so it's
+// a cheap way to route or skip files. It returns [FormatUnknown] if the content isn't recognized,
+// and an error only if the file can't be read.
+func DetectFormat(path string) (FileFormat, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return FormatUnknown, err
+	}
+	defer func() { _ = f.Close() }()
+	return DetectFormatReader(f)
+}
+
+// DetectFormatReader is like [DetectFormat] for the content of r.
+func DetectFormatReader(r io.ReaderAt) (FileFormat, error) {
+	var head [formatSniffSize]byte
+	b, err := readHead(r, head[:], 0)
+	if err != nil {
+		return FormatUnknown, err
+	}
+
+	// ID3v2 tags are found in front of MP3s, and sometimes of FLAC, APE and other formats too
+	if len(b) >= 10 && string(b[:3]) == "ID3" {
+		size := int64(b[6]&0x7f)<<21 | int64(b[7]&0x7f)<<14 | int64(b[8]&0x7f)<<7 | int64(b[9]&0x7f) // synchsafe
+		offset := 10 + size
+		if b[5]&0x10 != 0 {
+			offset += 10 // footer
+		}
+		if b, err = readHead(r, head[:], offset); err != nil {
+			return FormatUnknown, err
+		}
+		if format := sniffFormat(b); format != FormatUnknown {
+			return format, nil
+		}
+		return FormatMPEG, nil
+	}
+	return sniffFormat(b), nil
+}
+
+// Enough for the headers of every format, including an Ogg first page with all its segments
+const formatSniffSize = 512
+
+func readHead(r io.ReaderAt, buf []byte, offset int64) ([]byte, error) {
+	n, err := r.ReadAt(buf, offset)
+	if n == 0 && err != nil && err != io.EOF {
+		return nil, err
+	}
+	return buf[:n], nil
+}
+
+var asfHeaderGUID = []byte{0x30, 0x26, 0xb2, 0x75, 0x8e, 0x66, 0xcf, 0x11, 0xa6, 0xd9, 0x00, 0xaa, 0x00, 0x62, 0xce, 0x6c}
+
+func sniffFormat(b []byte) FileFormat {
+	magic := func(offset int, m string) bool {
+		return len(b) >= offset+len(m) && string(b[offset:offset+len(m)]) == m
+	}
+	switch {
+	case magic(0, "fLaC"):
+		return FormatFLAC
+	case magic(0, "OggS"):
+		return sniffOgg(b)
+	case magic(0, "RIFF") && magic(8, "WAVE"):
+		return FormatWAV
+	case magic(0, "FORM") && (magic(8, "AIFF") || magic(8, "AIFC")):
+		return FormatAIFF
+	case magic(0, "FRM8"):
+		return FormatDSDIFF
+	case magic(0, "DSD "):
+		return FormatDSF
+	case magic(4, "ftyp"):
+		return FormatMP4
+	case bytes.HasPrefix(b, asfHeaderGUID):
+		return FormatASF
+	case magic(0, "MAC "):
+		return FormatAPE
+	case magic(0, "wvpk"):
+		return FormatWavPack
+	case magic(0, "TTA1"):
+		return FormatTrueAudio
+	case magic(0, "MPCK"), magic(0, "MP+"):
+		return FormatMPC
+	case magic(0, "ajkg"):
+		return FormatShorten
+	case magic(0, "\x1a\x45\xdf\xa3"):
+		return FormatMatroska
+	case len(b) >= 2 && b[0] == 0xff && b[1]&0xe0 == 0xe0:
+		return FormatMPEG // frame sync
+	}
+	return FormatUnknown
+}
+
+// sniffOgg tells Ogg formats apart by the codec header in the first packet
+func sniffOgg(b []byte) FileFormat {
+	if len(b) < 27 {
+		return FormatUnknown
+	}
+	start := 27 + int(b[26]) // after the segment table
+	if start > len(b) {
+		return FormatUnknown
+	}
+	packet := string(b[start:])
+	switch {
+	case strings.HasPrefix(packet, "\x01vorbis"):
+		return FormatOggVorbis
+	case strings.HasPrefix(packet, "OpusHead"):
+		return FormatOggOpus
+	case strings.HasPrefix(packet, "\x7fFLAC"), strings.HasPrefix(packet, "fLaC"):
+		return FormatOggFLAC
+	case strings.HasPrefix(packet, "Speex   "):
+		return FormatOggSpeex
+	}
+	return FormatUnknown
+}
+
+// readSeekerAt reads an io.ReadSeeker like an io.ReaderAt, moving its position
+type readSeekerAt struct{ io.ReadSeeker }
+
+func (r readSeekerAt) ReadAt(p []byte, off int64) (int, error) {
+	if _, err := r.Seek(off, io.SeekStart); err != nil {
+		return 0, err
+	}
+	return io.ReadFull(r, p)
+}
+
 // ReadStyle controls how thoroughly audio properties are read from a file.
 // Higher accuracy requires reading more of the file, which takes longer.
 type ReadStyle uint8
@@ -130,7 +415,15 @@ type OpenOption func(*openOptions)
 
 type openOptions struct {
 	readStyle ReadStyle
-	filename  string // hint for format detection in OpenStream
+	filename  string     // hint for format detection in OpenStream
+	format    FileFormat // known format, so TagLib doesn't have to detect it
+	writerAt  io.WriterAt
+	truncate  func(size int64) error
+
+	skipAudioProperties bool
+
+	budgetBytes int64
+	budgetReads int
 }
 
 // WithReadStyle sets the read style for audio properties.
@@ -141,6 +434,34 @@ func WithReadStyle(style ReadStyle) OpenOption {
 	}
 }
 
+// WithAudioProperties sets whether audio properties are read when the file is opened.
+// Reading them can mean scanning MPEG frames or Ogg pages, so a File only used for its tags
+// opens faster without them. [File.Properties] then reads them the first time it's called.
+// Default is true.
+func WithAudioProperties(read bool) OpenOption {
+	return func(o *openOptions) {
+		o.skipAudioProperties = !read
+	}
+}
+
+// WithReadBudget caps how much of a stream a File reads over its life: at most bytes bytes
+// in at most reads calls into the reader, where 0 is no limit. Once either runs out, reads
+// end early as if the stream did, so tags near the start are still read. Properties found
+// that way have Estimated set, and a Length missing from them is estimated from the
+// stream's size and bitrate.
+//
+// It's meant for remote streams, where every read is a round trip, and works best with
+// [ReadStyleFast]. It applies to [OpenStream] and [OpenReaderAt], unless the File is writable,
+// since saving reads the whole stream. Without [WithFilename] or [WithFormat], format
+// detection makes up to two reads of 512 bytes first, which count against the budget. If the
+// budget can't spare them, detection is left to TagLib.
+func WithReadBudget(bytes int64, reads int) OpenOption {
+	return func(o *openOptions) {
+		o.budgetBytes = max(bytes, 0)
+		o.budgetReads = max(reads, 0)
+	}
+}
+
 // WithFilename provides a filename hint for format detection when using [OpenStream].
 // TagLib uses the file extension (e.g., ".opus", ".flac") to assist format detection.
 // Without this hint, TagLib relies on content-sniffing alone, which may fail for some formats.
@@ -150,35 +471,70 @@ func WithFilename(name string) OpenOption {
 	}
 }
 
+// WithFormat opens the file as the given format, for example one found by [DetectFormat],
+// skipping TagLib's own detection. If the file isn't valid in that format, the format is
+// detected as usual.
+//
+// Streams opened without [WithFilename] or WithFormat have their format detected with
+// [DetectFormatReader], since TagLib would otherwise try every format in turn.
+func WithFormat(format FileFormat) OpenOption {
+	return func(o *openOptions) {
+		o.format = format
+	}
+}
+
+// WithWriterAt makes a File opened with [OpenReaderAt] writable, saving changes through w.
+// w must write to the same data the reader reads. truncate is called when a save shrinks
+// the data. It can be nil if the data can't shrink, in which case saves that would shrink it fail.
+func WithWriterAt(w io.WriterAt, truncate func(size int64) error) OpenOption {
+	return func(o *openOptions) {
+		o.writerAt = w
+		o.truncate = truncate
+	}
+}
+
 // File represents an open audio file handle for efficient multiple operations.
 // Use [Open] or [OpenReadOnly] to create a File, and always call [File.Close] when done.
 type File struct {
-	mod      module
+	mod      *module
 	handle   uint32
 	format   FileFormat
-	streamId uint32 // non-zero if opened via OpenStream
+	streamId uint32 // non-zero if opened from a stream
 }
 
 // Open opens an audio file for reading and writing.
 // The returned File must be closed with [File.Close] when done.
 // Options can be provided to configure behavior (e.g., [WithReadStyle]).
 func Open(path string, opts ...OpenOption) (*File, error) {
+	return OpenContext(context.Background(), path, opts...)
+}
+
+// OpenContext is like [Open], but gives up on opening the file once ctx is done. Only the
+// open uses ctx; methods of the returned File named with a Context suffix take their own.
+func OpenContext(ctx context.Context, path string, opts ...OpenOption) (*File, error) {
 	o := &openOptions{readStyle: ReadStyleAverage}
 	for _, opt := range opts {
 		opt(o)
 	}
-	return openFile(path, false, o.readStyle)
+	return openFile(ctx, path, false, o)
 }
 
-// OpenReadOnly opens an audio file for reading only.
+// OpenReadOnly opens an audio file for reading only. Saving the returned File fails with
+// [ErrSavingFile]. In Wasm the file is mounted read-only, with the native backend the module
+// refuses the save itself.
 // The returned File must be closed with [File.Close] when done.
 // Options can be provided to configure behavior (e.g., [WithReadStyle]).
 func OpenReadOnly(path string, opts ...OpenOption) (*File, error) {
+	return OpenReadOnlyContext(context.Background(), path, opts...)
+}
+
+// OpenReadOnlyContext is like [OpenReadOnly], but gives up on opening the file once ctx is done.
+func OpenReadOnlyContext(ctx context.Context, path string, opts ...OpenOption) (*File, error) {
 	o := &openOptions{readStyle: ReadStyleAverage}
 	for _, opt := range opts {
 		opt(o)
 	}
-	return openFile(path, true, o.readStyle)
+	return openFile(ctx, path, true, o)
 }
 
 // OpenStream opens an audio stream for reading metadata.
@@ -187,12 +543,115 @@ func OpenReadOnly(path string, opts ...OpenOption) (*File, error) {
 // This is useful for reading from network streams, archives, or in-memory buffers.
 // Options can be provided to configure behavior (e.g., [WithReadStyle]).
 func OpenStream(r io.ReadSeeker, opts ...OpenOption) (*File, error) {
+	return OpenStreamContext(context.Background(), r, opts...)
+}
+
+// OpenStreamContext is like [OpenStream], but gives up on opening the stream once ctx is
+// done. Reads of r already in progress are waited for, but no more are made.
+func OpenStreamContext(ctx context.Context, r io.ReadSeeker, opts ...OpenOption) (*File, error) {
 	o := &openOptions{readStyle: ReadStyleAverage}
 	for _, opt := range opts {
 		opt(o)
 	}
+	o.sniffFormat(ctx, readSeekerAt{r}, HostRead)
 	streamId := registerStream(r)
+	return openStream(ctx, streamId, "taglib_stream_open", wasmUint32(streamId), wasmString(o.filename), wasmUint8(o.readStyle), wasmBool(false), wasmUint8(o.format), wasmBool(!o.skipAudioProperties), wasmInt64(o.budgetBytes), wasmUint32(o.budgetReads))
+}
+
+// OpenReadWriteStream opens an audio stream for reading and writing metadata.
+// Saves only write the byte ranges they change, with Seek and Write calls on rw.
+// When a save shrinks the stream, rw is cut with its Truncate(size int64) error method,
+// which [os.File] has. Without one, saves that would shrink the stream fail.
+// The stream must remain valid for the lifetime of the returned File.
+// The returned File must be closed with [File.Close] when done.
+// Options can be provided to configure behavior (e.g., [WithReadStyle]).
+func OpenReadWriteStream(rw io.ReadWriteSeeker, opts ...OpenOption) (*File, error) {
+	return OpenReadWriteStreamContext(context.Background(), rw, opts...)
+}
+
+// OpenReadWriteStreamContext is like [OpenReadWriteStream], but gives up on opening the
+// stream once ctx is done. Reads of rw already in progress are waited for, but no more are
+// made. The context isn't kept, so saves of the returned File take their own.
+func OpenReadWriteStreamContext(ctx context.Context, rw io.ReadWriteSeeker, opts ...OpenOption) (*File, error) {
+	o := &openOptions{readStyle: ReadStyleAverage}
+	for _, opt := range opts {
+		opt(o)
+	}
+	o.sniffFormat(ctx, readSeekerAt{rw}, HostRead)
+	streamId := registerStream(readWriteStream{rw})
+	return openStream(ctx, streamId, "taglib_stream_open", wasmUint32(streamId), wasmString(o.filename), wasmUint8(o.readStyle), wasmBool(true), wasmUint8(o.format), wasmBool(!o.skipAudioProperties), wasmInt64(o.budgetBytes), wasmUint32(o.budgetReads))
+}
+
+// OpenReaderAt opens an audio stream of the given size for reading metadata.
+// Every block is fetched with a single ReadAt call and no shared cursor, so reading costs
+// fewer calls into r than [OpenStream], and one r can serve several Files at once.
+// Use [WithWriterAt] to make it writable.
+// The reader must remain valid for the lifetime of the returned File.
+// The returned File must be closed with [File.Close] when done.
+// Options can be provided to configure behavior (e.g., [WithReadStyle]).
+func OpenReaderAt(r io.ReaderAt, size int64, opts ...OpenOption) (*File, error) {
+	return OpenReaderAtContext(context.Background(), r, size, opts...)
+}
+
+// OpenReaderAtContext is like [OpenReaderAt], but gives up on opening the stream once ctx
+// is done. Reads of r already in progress are waited for, but no more are made.
+func OpenReaderAtContext(ctx context.Context, r io.ReaderAt, size int64, opts ...OpenOption) (*File, error) {
+	o := &openOptions{readStyle: ReadStyleAverage}
+	for _, opt := range opts {
+		opt(o)
+	}
+	o.sniffFormat(ctx, r, HostReadAt)
+	streamId := registerStream(readerAtStream{r, o.writerAt, o.truncate})
+	return openStream(ctx, streamId, "taglib_stream_open_reader_at", wasmUint32(streamId), wasmInt64(size), wasmString(o.filename), wasmUint8(o.readStyle), wasmBool(o.writerAt != nil), wasmUint8(o.format), wasmBool(!o.skipAudioProperties), wasmInt64(o.budgetBytes), wasmUint32(o.budgetReads))
+}
 
+// sniffFormat sets the format of a stream with no other hint. Errors are left for TagLib to find.
+// Its reads are reported to Metrics as op and taken out of the read budget, like the module's
+// own. A budget that can't cover them with some left over for the module skips detection.
+func (o *openOptions) sniffFormat(ctx context.Context, r io.ReaderAt, op HostIOOp) {
+	if o.format != FormatUnknown || o.filename != "" {
+		return
+	}
+	// The head of the stream, and the head after an ID3v2 tag
+	if (o.budgetBytes > 0 && o.budgetBytes <= 2*formatSniffSize) || (o.budgetReads > 0 && o.budgetReads <= 2) {
+		return
+	}
+
+	cr := &countingReaderAt{ctx: ctx, r: r, op: op}
+	o.format, _ = DetectFormatReader(cr)
+	if o.budgetBytes > 0 {
+		o.budgetBytes -= cr.bytes
+	}
+	if o.budgetReads > 0 {
+		o.budgetReads -= cr.reads
+	}
+}
+
+// countingReaderAt counts the reads made of r, and reports them to Metrics. Once ctx is done,
+// no more are made.
+type countingReaderAt struct {
+	ctx   context.Context
+	r     io.ReaderAt
+	op    HostIOOp
+	bytes int64
+	reads int
+}
+
+func (c *countingReaderAt) ReadAt(p []byte, off int64) (int, error) {
+	if err := c.ctx.Err(); err != nil {
+		return 0, err
+	}
+	mt, start := startHostIO()
+	n, err := c.r.ReadAt(p, off)
+	c.bytes += int64(n)
+	c.reads++
+	if mt != nil {
+		mt.HostIO(HostIOInfo{Op: c.op, Bytes: int64(n), Duration: time.Since(start)})
+	}
+	return n, err
+}
+
+func openStream(ctx context.Context, streamId uint32, export string, args ...wasmArg) (*File, error) {
 	mod, err := newModuleForStream()
 	if err != nil {
 		unregisterStream(streamId)
@@ -200,17 +659,18 @@ func OpenStream(r io.ReadSeeker, opts ...OpenOption) (*File, error) {
 	}
 
 	var result wasmOpenResult
-	if err := mod.call("taglib_stream_open", &result, wasmUint32(streamId), wasmString(o.filename), wasmUint8(o.readStyle)); err != nil {
-		mod.close()
+	if err := mod.callContext(ctx, export, &result, args...); err != nil {
+		mod.release()
 		unregisterStream(streamId)
 		return nil, fmt.Errorf("call: %w", err)
 	}
 	if result.handle == 0 {
-		mod.close()
+		mod.release()
 		unregisterStream(streamId)
 		return nil, ErrInvalidFile
 	}
 
+	mod.format = FileFormat(result.format)
 	return &File{
 		mod:      mod,
 		handle:   result.handle,
@@ -219,34 +679,34 @@ func OpenStream(r io.ReadSeeker, opts ...OpenOption) (*File, error) {
 	}, nil
 }
 
-func openFile(path string, readOnly bool, readStyle ReadStyle) (*File, error) {
+func openFile(ctx context.Context, path string, readOnly bool, o *openOptions) (*File, error) {
 	var err error
 	path, err = filepath.Abs(path)
 	if err != nil {
 		return nil, fmt.Errorf("make path abs: %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	var mod module
+	var mod *module
 	if readOnly {
-		mod, err = newModuleRO(dir)
+		mod, err = newModuleRO(path)
 	} else {
-		mod, err = newModule(dir)
+		mod, err = newModule(path)
 	}
 	if err != nil {
 		return nil, fmt.Errorf("init module: %w", err)
 	}
 
 	var result wasmOpenResult
-	if err := mod.call("taglib_file_open", &result, wasmString(wasmPath(path)), wasmUint8(readStyle)); err != nil {
-		mod.close()
+	if err := mod.callContext(ctx, "taglib_file_open", &result, wasmString(wasmPath(path)), wasmUint8(o.readStyle), wasmUint8(o.format), wasmBool(!o.skipAudioProperties)); err != nil {
+		mod.release()
 		return nil, fmt.Errorf("call: %w", err)
 	}
 	if result.handle == 0 {
-		mod.close()
+		mod.release()
 		return nil, ErrInvalidFile
 	}
 
+	mod.format = FileFormat(result.format)
 	return &File{
 		mod:    mod,
 		handle: result.handle,
@@ -267,7 +727,7 @@ func (f *File) Close() error {
 		unregisterStream(f.streamId)
 		f.streamId = 0
 	}
-	f.mod.close()
+	f.mod.release()
 	return nil
 }
 
@@ -278,47 +738,66 @@ func (f *File) Format() FileFormat {
 
 // Tags reads all normalized metadata tags from the file.
 func (f *File) Tags() map[string][]string {
-	var raw wasmStrings
-	if err := f.mod.call("taglib_handle_tags", &raw, wasmUint32(f.handle)); err != nil {
-		return nil
-	}
-	if raw == nil {
-		return nil
+	tags, _ := f.TagsContext(context.Background())
+	return tags
+}
+
+// TagsContext is like [File.Tags], but gives up once ctx is done and returns why it failed.
+func (f *File) TagsContext(ctx context.Context) (map[string][]string, error) {
+	var tags wasmTags
+	if err := f.mod.callContext(ctx, "taglib_handle_tags", &tags, wasmUint32(f.handle)); err != nil {
+		return nil, fmt.Errorf("call: %w", err)
 	}
+	return tags, nil
+}
 
-	tags := map[string][]string{}
-	for _, row := range raw {
-		k, v, ok := strings.Cut(row, "\t")
-		if !ok {
-			continue
-		}
-		tags[k] = append(tags[k], v)
+// VisitTags calls fn for every tag value of the file, in the order [File.Tags] would add
+// them, until fn returns false. Keys are passed once per value. Unlike Tags, no map or
+// strings are built: key and value are views of the module's memory, only valid until
+// fn returns, and fn must not call other methods of f. Copy what needs to be kept, for
+// example with [InternKey].
+func (f *File) VisitTags(fn func(key, value []byte) bool) error {
+	return f.VisitTagsContext(context.Background(), fn)
+}
+
+// VisitTagsContext is like [File.VisitTags], but gives up once ctx is done and returns
+// why it failed. fn is only called once all the tags have been read in time.
+func (f *File) VisitTagsContext(ctx context.Context, fn func(key, value []byte) bool) error {
+	visit := wasmVisitTags{fn: fn}
+	if err := f.mod.callContext(ctx, "taglib_handle_tags", &visit, wasmUint32(f.handle)); err != nil {
+		return fmt.Errorf("call: %w", err)
 	}
+	return visit.err
+}
+
+// TagsFor reads only the tags with the given keys, like [File.Tags] but without converting
+// and copying the values of every other tag, such as long lyrics or comments. Keys are
+// matched case-insensitively and returned in upper case. Keys the file doesn't have are
+// left out of the result.
+func (f *File) TagsFor(keys ...string) map[string][]string {
+	tags, _ := f.TagsForContext(context.Background(), keys...)
 	return tags
 }
 
+// TagsForContext is like [File.TagsFor], but gives up once ctx is done and returns why it failed.
+func (f *File) TagsForContext(ctx context.Context, keys ...string) (map[string][]string, error) {
+	var tags wasmTags
+	if err := f.mod.callContext(ctx, "taglib_handle_tags_keys", &tags, wasmUint32(f.handle), wasmStrings(keys)); err != nil {
+		return nil, fmt.Errorf("call: %w", err)
+	}
+	return tags, nil
+}
+
 // RawTags reads format-specific tags from the file.
 // For MP3/WAV/AIFF: returns ID3v2 frames
 // For MP4: returns MP4 atoms
 // For ASF: returns ASF attributes
 // For other formats (FLAC, OGG, etc.): returns same as Tags() (Vorbis Comments)
 func (f *File) RawTags() map[string][]string {
-	var raw wasmStrings
-	if err := f.mod.call("taglib_handle_raw_tags", &raw, wasmUint32(f.handle)); err != nil {
-		return nil
-	}
-	if raw == nil {
+	var tags wasmTags
+	if err := f.mod.call("taglib_handle_raw_tags", &tags, wasmUint32(f.handle)); err != nil {
 		return nil
 	}
-
-	tags := map[string][]string{}
-	for _, row := range raw {
-		k, v, ok := strings.Cut(row, "\t")
-		if !ok {
-			continue
-		}
-		tags[k] = append(tags[k], v)
-	}
 	return tags
 }
 
@@ -343,58 +822,169 @@ func (f *File) AllTags() AllTags {
 
 // Properties reads the audio properties from the file.
 func (f *File) Properties() Properties {
+	props, _ := f.PropertiesContext(context.Background())
+	return props
+}
+
+// PropertiesContext is like [File.Properties], but gives up once ctx is done and returns
+// why it failed.
+func (f *File) PropertiesContext(ctx context.Context) (Properties, error) {
 	var raw wasmFileProperties
-	if err := f.mod.call("taglib_handle_properties", &raw, wasmUint32(f.handle)); err != nil {
-		return Properties{}
+	if err := f.mod.callContext(ctx, "taglib_handle_properties", &raw, wasmUint32(f.handle)); err != nil {
+		return Properties{}, fmt.Errorf("call: %w", err)
 	}
+	return raw.properties(), nil
+}
 
-	var images []ImageDesc
-	for _, row := range raw.imageDescs {
-		parts := strings.SplitN(row, "\t", 3)
-		if len(parts) != 3 {
-			continue
-		}
-		images = append(images, ImageDesc{
-			Type:        parts[0],
-			Description: parts[1],
-			MIMEType:    parts[2],
-		})
-	}
+// Metadata contains everything read by [File.ReadAll] and [ReadAll].
+type Metadata struct {
+	AllTags
+	// Properties contains the audio properties and embedded image metadata
+	Properties Properties
+}
 
-	return Properties{
-		Length:        time.Duration(raw.lengthInMilliseconds) * time.Millisecond,
-		Channels:      uint(raw.channels),
-		SampleRate:    uint(raw.sampleRate),
-		Bitrate:       uint(raw.bitrate),
-		BitsPerSample: uint(raw.bitsPerSample),
-		Codec:         raw.codec,
-		Images:        images,
+// ReadAll reads normalized tags, format-specific tags and audio properties in a single call.
+// It's equivalent to calling [File.AllTags] and [File.Properties], but only walks the file once.
+func (f *File) ReadAll() Metadata {
+	md, _ := f.ReadAllContext(context.Background())
+	return md
+}
+
+// ReadAllContext is like [File.ReadAll], but gives up once ctx is done and returns why it failed.
+func (f *File) ReadAllContext(ctx context.Context) (Metadata, error) {
+	var raw wasmReadAll
+	if err := f.mod.callContext(ctx, "taglib_handle_read_all", &raw, wasmUint32(f.handle)); err != nil {
+		return Metadata{AllTags: AllTags{Format: f.format}}, fmt.Errorf("call: %w", err)
 	}
+	return raw.metadata(), nil
 }
 
 // Image reads the embedded image at the specified index from the file.
 // Index 0 is the first image. Returns empty byte slice if index is out of range.
 func (f *File) Image(index int) ([]byte, error) {
+	return f.ImageContext(context.Background(), index)
+}
+
+// ImageContext is like [File.Image], but gives up once ctx is done.
+func (f *File) ImageContext(ctx context.Context, index int) ([]byte, error) {
 	var img wasmBytes
-	if err := f.mod.call("taglib_handle_image", &img, wasmUint32(f.handle), wasmInt(index)); err != nil {
+	if err := f.mod.callContext(ctx, "taglib_handle_image", &img, wasmUint32(f.handle), wasmInt(index)); err != nil {
 		return nil, fmt.Errorf("call: %w", err)
 	}
 	return img, nil
 }
 
+// StreamStats counts the reads and writes a [File] opened from a stream made of it.
+type StreamStats struct {
+	// Hits is the number of reads served entirely from blocks already cached by the module
+	Hits uint64
+	// Misses is the number of reads that needed data from the reader
+	Misses uint64
+	// ReaderCalls is the number of reads the module asked of the reader
+	ReaderCalls uint64
+	// BytesRead is the number of bytes the reader returned
+	BytesRead uint64
+	// WriterCalls is the number of writes the module asked of the stream
+	WriterCalls uint64
+	// BytesWritten is the number of bytes the stream accepted
+	BytesWritten uint64
+}
+
+// StreamStats returns read counters for a File opened with [OpenStream] or [OpenReaderAt].
+// It returns zero values for files opened from a path.
+func (f *File) StreamStats() StreamStats {
+	var stats wasmStreamStats
+	if err := f.mod.call("taglib_handle_stream_stats", &stats, wasmUint32(f.handle)); err != nil {
+		return StreamStats{}
+	}
+	return StreamStats(stats)
+}
+
+// MemoryStats describes the memory of the module instance behind a [File].
+type MemoryStats struct {
+	// Size is the size of the module's linear memory in bytes. Wasm memory never shrinks,
+	// so this is the most the instance has needed at any point.
+	Size uint64
+	// ResultPeak is the most memory the arguments and results of a single call have needed
+	ResultPeak uint64
+	// ResultReserved is the memory currently held for call arguments and results
+	ResultReserved uint64
+}
+
+// MemoryStats reports how much memory the module instance of the File uses. Results are
+// freed before the next call, so it stays flat however many calls are made on the File.
+func (f *File) MemoryStats() MemoryStats {
+	var stats wasmArenaStats
+	if err := f.mod.call("taglib_arena_stats", &stats); err != nil {
+		return MemoryStats{}
+	}
+	return MemoryStats{
+		Size:           uint64(f.mod.mod.memory().Size()),
+		ResultPeak:     stats.peak,
+		ResultReserved: stats.reserved,
+	}
+}
+
+// ImageSize returns the size in bytes of the embedded image at the specified index,
+// or 0 if index is out of range. Use it to size a buffer for [File.ImageInto].
+func (f *File) ImageSize(index int) (int, error) {
+	var size wasmInt
+	if err := f.mod.call("taglib_handle_image_size", &size, wasmUint32(f.handle), wasmInt(index)); err != nil {
+		return 0, fmt.Errorf("call: %w", err)
+	}
+	return max(int(size), 0), nil
+}
+
+// ImageInto copies the embedded image at the specified index into dst and returns the
+// number of bytes copied, 0 if index is out of range. If dst is too small to hold the
+// image, it returns [io.ErrShortBuffer] and copies nothing.
+func (f *File) ImageInto(index int, dst []byte) (int, error) {
+	var img wasmView
+	if err := f.mod.call("taglib_handle_image", &img, wasmUint32(f.handle), wasmInt(index)); err != nil {
+		return 0, fmt.Errorf("call: %w", err)
+	}
+	if len(img) > len(dst) {
+		return 0, io.ErrShortBuffer
+	}
+	return copy(dst, img), nil
+}
+
+// ImageTo writes the embedded image at the specified index to w and returns the number
+// of bytes written, 0 if index is out of range. The data is passed to w straight out of
+// the module's memory, so w must not retain the slice it's given.
+func (f *File) ImageTo(index int, w io.Writer) (int64, error) {
+	var img wasmView
+	if err := f.mod.call("taglib_handle_image", &img, wasmUint32(f.handle), wasmInt(index)); err != nil {
+		return 0, fmt.Errorf("call: %w", err)
+	}
+	if len(img) == 0 {
+		return 0, nil
+	}
+	n, err := w.Write(img)
+	return int64(n), err
+}
+
 // WriteTags writes the metadata key-values pairs to the file.
 // The behavior can be controlled with [WriteOption].
+// If the file already has exactly these tags, it isn't saved. Use [File.Edit] to find out.
 func (f *File) WriteTags(tags map[string][]string, opts WriteOption) error {
-	var raw []string
-	for k, vs := range tags {
-		raw = append(raw, fmt.Sprintf("%s\t%s", k, strings.Join(vs, "\v")))
+	return f.WriteTagsContext(context.Background(), tags, opts)
+}
+
+// WriteTagsContext is like [File.WriteTags], but doesn't start the save if ctx is already
+// done. A save that has started always runs to the end, since stopping it partway would
+// leave the file corrupt.
+func (f *File) WriteTagsContext(ctx context.Context, tags map[string][]string, opts WriteOption) error {
+	if err := ctx.Err(); err != nil {
+		return err
 	}
+	raw := tagRows(tags)
 
-	var out wasmBool
-	if err := f.mod.call("taglib_handle_write_tags", &out, wasmUint32(f.handle), wasmStrings(raw), wasmUint8(opts)); err != nil {
+	var out writeStatus
+	if err := f.mod.callContext(context.WithoutCancel(ctx), "taglib_handle_write_tags", &out, wasmUint32(f.handle), wasmStrings(raw), wasmUint8(opts)); err != nil {
 		return fmt.Errorf("call: %w", err)
 	}
-	if !out {
+	if out == writeFailed {
 		return ErrSavingFile
 	}
 	return nil
@@ -404,16 +994,163 @@ func (f *File) WriteTags(tags map[string][]string, opts WriteOption) error {
 // Index specifies which image slot to write to (0 = first image).
 // Set image to nil to clear the image at that index.
 func (f *File) WriteImage(image []byte, index int, imageType, description, mimeType string) error {
-	var out wasmBool
-	if err := f.mod.call("taglib_handle_write_image", &out, wasmUint32(f.handle), wasmBytes(image), wasmUint32(uint32(len(image))), wasmInt(index), wasmString(imageType), wasmString(description), wasmString(mimeType)); err != nil {
+	return f.WriteImageContext(context.Background(), image, index, imageType, description, mimeType)
+}
+
+// WriteImageContext is like [File.WriteImage], but doesn't start the save if ctx is already
+// done. A save that has started always runs to the end, like [File.WriteTagsContext].
+func (f *File) WriteImageContext(ctx context.Context, image []byte, index int, imageType, description, mimeType string) error {
+	if err := ctx.Err(); err != nil {
+		return err
+	}
+	var out writeStatus
+	if err := f.mod.callContext(context.WithoutCancel(ctx), "taglib_handle_write_image", &out, wasmUint32(f.handle), wasmBytes(image), wasmUint32(uint32(len(image))), wasmInt(index), wasmString(imageType), wasmString(description), wasmString(mimeType)); err != nil {
 		return fmt.Errorf("call: %w", err)
 	}
-	if !out {
+	if out == writeFailed {
 		return ErrSavingFile
 	}
 	return nil
 }
 
+// Edit collects changes to a [File] so [Edit.Apply] can write them with a single save,
+// instead of rewriting the file once per change. Create one with [File.Edit].
+type Edit struct {
+	f *File
+
+	tags      map[string][]string
+	tagOpts   WriteOption
+	frames    map[string][]string
+	frameOpts WriteOption
+	pictures  []byte // packed picture edits, see taglib_handle_apply
+	nPictures uint32
+	padding   uint32
+}
+
+// Edit starts a set of changes to the file. Nothing is written until [Edit.Apply].
+func (f *File) Edit() *Edit {
+	return &Edit{f: f}
+}
+
+// SetTags writes tags like [File.WriteTags].
+func (e *Edit) SetTags(tags map[string][]string, opts WriteOption) *Edit {
+	if tags == nil {
+		tags = map[string][]string{}
+	}
+	e.tags, e.tagOpts = tags, opts
+	return e
+}
+
+// SetID3v2Frames writes ID3v2 frames like [WriteID3v2Frames]. It's only supported for MP3 files.
+func (e *Edit) SetID3v2Frames(frames map[string][]string, opts WriteOption) *Edit {
+	if frames == nil {
+		frames = map[string][]string{}
+	}
+	e.frames, e.frameOpts = frames, opts
+	return e
+}
+
+// SetImage writes an image like [File.WriteImage].
+// Index specifies which image slot to write to (0 = first image).
+func (e *Edit) SetImage(image []byte, index int, imageType, description, mimeType string) *Edit {
+	e.pictures = appendUint32(e.pictures, uint32(int32(index)))
+	e.pictures = appendField(e.pictures, string(image))
+	e.pictures = appendField(e.pictures, imageType)
+	e.pictures = appendField(e.pictures, description)
+	e.pictures = appendField(e.pictures, mimeType)
+	e.nPictures++
+	return e
+}
+
+// RemoveImage removes the image at index, shifting later images down.
+func (e *Edit) RemoveImage(index int) *Edit {
+	return e.SetImage(nil, index, "", "", "")
+}
+
+// ReservePadding makes Apply leave at least n bytes of free space in the tag, so later
+// writes that grow it a little can update it in place instead of rewriting the whole file.
+// It's supported for MP3 (ID3v2 padding), FLAC (PADDING block) and MP4 (free atom) files,
+// and ignored for other formats. TagLib caps the padding it keeps at 1% of the file size,
+// up to 1MiB, so larger reserves are trimmed. The padding is made by saving once with a
+// placeholder tag of that size and again without it. If only the second save fails, Apply
+// returns an error wrapping [ErrSavingFile] and the placeholder is left in the file.
+func (e *Edit) ReservePadding(n int) *Edit {
+	e.padding = uint32(min(max(n, 0), maxPadding))
+	return e
+}
+
+// maxPadding is the most padding TagLib keeps. Must match C++'s MAX_PADDING
+const maxPadding = 1 << 20
+
+// WriteReport describes what [Edit.Apply] did to the file.
+type WriteReport struct {
+	// Unchanged is set if the file already matched every change, so it wasn't saved
+	// and is left exactly as it was, modification time included
+	Unchanged bool
+	// InPlace is set if the changes fit in the space the tags already had, so the file
+	// kept its length and its audio data wasn't moved
+	InPlace bool
+}
+
+// Apply writes all the changes with a single save. Tags are applied first, then ID3v2
+// frames, then images in the order they were set, as if written one after the other.
+// If none of them change anything, the file isn't saved at all.
+func (e *Edit) Apply() (WriteReport, error) {
+	return e.ApplyContext(context.Background())
+}
+
+// ApplyContext is like [Edit.Apply], but doesn't start the save if ctx is already done.
+// A save that has started always runs to the end, like [File.WriteTagsContext].
+func (e *Edit) ApplyContext(ctx context.Context) (WriteReport, error) {
+	if err := ctx.Err(); err != nil {
+		return WriteReport{}, err
+	}
+	var tags, frames, pictures wasmArg = wasmNull{}, wasmNull{}, wasmNull{}
+	if e.tags != nil {
+		tags = wasmStrings(tagRows(e.tags))
+	}
+	if e.frames != nil {
+		frames = wasmStrings(tagRows(e.frames))
+	}
+	if e.nPictures > 0 {
+		pictures = wasmBytes(append(appendUint32(nil, e.nPictures), e.pictures...))
+	}
+
+	var out writeStatus
+	if err := e.f.mod.callContext(context.WithoutCancel(ctx), "taglib_handle_apply", &out, wasmUint32(e.f.handle), tags, wasmUint8(e.tagOpts), frames, wasmUint8(e.frameOpts), pictures, wasmUint32(e.padding)); err != nil {
+		return WriteReport{}, fmt.Errorf("call: %w", err)
+	}
+	if out == writeFailed {
+		return WriteReport{}, ErrSavingFile
+	}
+	if out == writePaddingLeft {
+		return WriteReport{}, fmt.Errorf("%w: saved, but the padding placeholder was left in the tag", ErrSavingFile)
+	}
+	return WriteReport{Unchanged: out == writeUnchanged, InPlace: out == writeSavedInPlace}, nil
+}
+
+func appendUint32(b []byte, v uint32) []byte {
+	return append(b, byte(v), byte(v>>8), byte(v>>16), byte(v>>24))
+}
+
+func leUint32(b []byte) uint32 {
+	return uint32(b[0]) | uint32(b[1])<<8 | uint32(b[2])<<16 | uint32(b[3])<<24
+}
+
+func appendField(b []byte, s string) []byte {
+	return append(appendUint32(b, uint32(len(s))), s...)
+}
+
+// tagRows encodes tags as "KEY\tVALUE" rows for the write exports, with multiple values
+// joined by "\v".
+func tagRows(tags map[string][]string) []string {
+	rows := make([]string, 0, len(tags))
+	for k, vs := range tags {
+		rows = append(rows, fmt.Sprintf("%s\t%s", k, strings.Join(vs, "\v")))
+	}
+	return rows
+}
+
 // These constants define normalized tag keys used by TagLib's [property mapping].
 // When using [ReadTags], the library will map format-specific metadata to these standardized keys.
 // Similarly, [WriteTags] will map these keys back to the appropriate format-specific fields.
@@ -525,36 +1262,178 @@ const (
 	Work                      = "WORK"
 )
 
+// internedKeys holds the keys above, so InternKey can return them without allocating
+var internedKeys = func() map[string]string {
+	keys := map[string]string{}
+	for _, k := range []string{
+		AcoustIDFingerprint,
+		AcoustIDID,
+		Album,
+		AlbumArtist,
+		AlbumArtistSort,
+		AlbumSort,
+		Arranger,
+		Artist,
+		Artists,
+		ArtistSort,
+		ArtistWebpage,
+		ASIN,
+		AudioSourceWebpage,
+		Barcode,
+		BPM,
+		CatalogNumber,
+		Comment,
+		Compilation,
+		Composer,
+		ComposerSort,
+		Conductor,
+		Copyright,
+		CopyrightURL,
+		Date,
+		DiscNumber,
+		DiscSubtitle,
+		DJMixer,
+		EncodedBy,
+		Encoding,
+		EncodingTime,
+		Engineer,
+		FileType,
+		FileWebpage,
+		GaplessPlayback,
+		Genre,
+		Grouping,
+		InitialKey,
+		InvolvedPeople,
+		ISRC,
+		Label,
+		Language,
+		Length,
+		License,
+		Lyricist,
+		Lyrics,
+		Media,
+		Mixer,
+		Mood,
+		MovementCount,
+		MovementName,
+		MovementNumber,
+		MusicBrainzAlbumID,
+		MusicBrainzAlbumArtistID,
+		MusicBrainzArtistID,
+		MusicBrainzReleaseGroupID,
+		MusicBrainzReleaseTrackID,
+		MusicBrainzTrackID,
+		MusicBrainzWorkID,
+		MusicianCredits,
+		MusicIPPUID,
+		OriginalAlbum,
+		OriginalArtist,
+		OriginalDate,
+		OriginalFilename,
+		OriginalLyricist,
+		Owner,
+		PaymentWebpage,
+		Performer,
+		PlaylistDelay,
+		Podcast,
+		PodcastCategory,
+		PodcastDesc,
+		PodcastID,
+		PodcastURL,
+		ProducedNotice,
+		Producer,
+		PublisherWebpage,
+		RadioStation,
+		RadioStationOwner,
+		RadioStationWebpage,
+		ReleaseCountry,
+		ReleaseDate,
+		ReleaseStatus,
+		ReleaseType,
+		Remixer,
+		Script,
+		ShowSort,
+		ShowWorkMovement,
+		Subtitle,
+		TaggingDate,
+		Title,
+		TitleSort,
+		TrackNumber,
+		TVEpisode,
+		TVEpisodeID,
+		TVNetwork,
+		TVSeason,
+		TVShow,
+		URL,
+		Work,
+	} {
+		keys[k] = k
+	}
+	return keys
+}()
+
+// InternKey returns key as a string. For the keys defined by this package, such as [Title]
+// and [Artist], it returns the package's own copy instead of allocating a new one. Use it
+// to keep keys passed to a [File.VisitTags] callback.
+func InternKey(key []byte) string {
+	if k, ok := internedKeys[string(key)]; ok {
+		return k
+	}
+	return string(key)
+}
+
 // ReadTags reads all metadata tags from an audio file at the given path.
 func ReadTags(path string) (map[string][]string, error) {
+	return ReadTagsContext(context.Background(), path)
+}
+
+// ReadTagsContext is like [ReadTags], but gives up once ctx is done. A read stopped partway
+// has its module instance replaced rather than pooled again, so its state can't leak into
+// the next read.
+func ReadTagsContext(ctx context.Context, path string) (map[string][]string, error) {
 	var err error
 	path, err = filepath.Abs(path)
 	if err != nil {
 		return nil, fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModuleRO(dir)
+	mod, err := newModuleRO(path)
 	if err != nil {
 		return nil, fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
-	var raw wasmStrings
-	if err := mod.call("taglib_file_tags", &raw, wasmString(wasmPath(path))); err != nil {
+	var tags wasmTags
+	if err := mod.callContext(ctx, "taglib_file_tags", &tags, wasmString(wasmPath(path))); err != nil {
 		return nil, fmt.Errorf("call: %w", err)
 	}
-	if raw == nil {
+	if tags == nil {
 		return nil, ErrInvalidFile
 	}
+	return tags, nil
+}
 
-	var tags = map[string][]string{}
-	for _, row := range raw {
-		k, v, ok := strings.Cut(row, "\t")
-		if !ok {
-			continue
-		}
-		tags[k] = append(tags[k], v)
+// ReadTagsKeys reads only the tags with the given keys from the file at path, like
+// [File.TagsFor].
+func ReadTagsKeys(path string, keys []string) (map[string][]string, error) {
+	var err error
+	path, err = filepath.Abs(path)
+	if err != nil {
+		return nil, fmt.Errorf("make path abs %w", err)
+	}
+
+	mod, err := newModuleRO(path)
+	if err != nil {
+		return nil, fmt.Errorf("init module: %w", err)
+	}
+	defer mod.release()
+
+	var tags wasmTags
+	if err := mod.call("taglib_file_tags_keys", &tags, wasmString(wasmPath(path)), wasmStrings(keys)); err != nil {
+		return nil, fmt.Errorf("call: %w", err)
+	}
+	if tags == nil {
+		return nil, ErrInvalidFile
 	}
 	return tags, nil
 }
@@ -571,30 +1450,19 @@ func ReadID3v2Frames(path string) (map[string][]string, error) {
 		return nil, fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModuleRO(dir)
+	mod, err := newModuleRO(path)
 	if err != nil {
 		return nil, fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
-	var raw wasmStrings
-	if err := mod.call("taglib_file_id3v2_frames", &raw, wasmString(wasmPath(path))); err != nil {
+	var frames wasmTags
+	if err := mod.call("taglib_file_id3v2_frames", &frames, wasmString(wasmPath(path))); err != nil {
 		return nil, fmt.Errorf("call: %w", err)
 	}
-	if raw == nil {
+	if frames == nil {
 		return nil, ErrInvalidFile
 	}
-
-	// If raw is empty, the file has no ID3v2 frames
-	var frames = map[string][]string{}
-	for _, row := range raw {
-		parts := strings.SplitN(row, "\t", 2)
-		if len(parts) != 2 {
-			continue
-		}
-		frames[parts[0]] = append(frames[parts[0]], parts[1])
-	}
 	return frames, nil
 }
 
@@ -609,30 +1477,19 @@ func ReadID3v1Frames(path string) (map[string][]string, error) {
 		return nil, fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModuleRO(dir)
+	mod, err := newModuleRO(path)
 	if err != nil {
 		return nil, fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
-	var raw wasmStrings
-	if err := mod.call("taglib_file_id3v1_tags", &raw, wasmString(wasmPath(path))); err != nil {
+	var frames wasmTags
+	if err := mod.call("taglib_file_id3v1_tags", &frames, wasmString(wasmPath(path))); err != nil {
 		return nil, fmt.Errorf("call: %w", err)
 	}
-	if raw == nil {
+	if frames == nil {
 		return nil, ErrInvalidFile
 	}
-
-	// If raw is empty, the file has no ID3v1 tags
-	var frames = map[string][]string{}
-	for _, row := range raw {
-		parts := strings.SplitN(row, "\t", 2)
-		if len(parts) != 2 {
-			continue
-		}
-		frames[parts[0]] = append(frames[parts[0]], parts[1])
-	}
 	return frames, nil
 }
 
@@ -649,30 +1506,19 @@ func ReadMP4Atoms(path string) (map[string][]string, error) {
 		return nil, fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModuleRO(dir)
+	mod, err := newModuleRO(path)
 	if err != nil {
 		return nil, fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
-	var raw wasmStrings
-	if err := mod.call("taglib_file_mp4_atoms", &raw, wasmString(wasmPath(path))); err != nil {
+	var atoms wasmTags
+	if err := mod.call("taglib_file_mp4_atoms", &atoms, wasmString(wasmPath(path))); err != nil {
 		return nil, fmt.Errorf("call: %w", err)
 	}
-	if raw == nil {
+	if atoms == nil {
 		return nil, ErrInvalidFile
 	}
-
-	// If raw is empty, the file has no MP4 atoms
-	var atoms = map[string][]string{}
-	for _, row := range raw {
-		parts := strings.SplitN(row, "\t", 2)
-		if len(parts) != 2 {
-			continue
-		}
-		atoms[parts[0]] = append(atoms[parts[0]], parts[1])
-	}
 	return atoms, nil
 }
 
@@ -688,30 +1534,19 @@ func ReadASFAttributes(path string) (map[string][]string, error) {
 		return nil, fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModuleRO(dir)
+	mod, err := newModuleRO(path)
 	if err != nil {
 		return nil, fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
-	var raw wasmStrings
-	if err := mod.call("taglib_file_asf_attributes", &raw, wasmString(wasmPath(path))); err != nil {
+	var attrs wasmTags
+	if err := mod.call("taglib_file_asf_attributes", &attrs, wasmString(wasmPath(path))); err != nil {
 		return nil, fmt.Errorf("call: %w", err)
 	}
-	if raw == nil {
+	if attrs == nil {
 		return nil, ErrInvalidFile
 	}
-
-	// If raw is empty, the file has no ASF attributes
-	var attrs = map[string][]string{}
-	for _, row := range raw {
-		parts := strings.SplitN(row, "\t", 2)
-		if len(parts) != 2 {
-			continue
-		}
-		attrs[parts[0]] = append(attrs[parts[0]], parts[1])
-	}
 	return attrs, nil
 }
 
@@ -731,6 +1566,9 @@ type Properties struct {
 	Codec string
 	// Images contains metadata about all embedded images
 	Images []ImageDesc
+	// Estimated is set when a [WithReadBudget] budget ran out before TagLib had read all it
+	// wanted, so the other fields may be off. A Length TagLib couldn't find is estimated.
+	Estimated bool
 }
 
 // ImageDesc contains metadata about an embedded image without the actual image data.
@@ -741,50 +1579,925 @@ type ImageDesc struct {
 	Description string
 	// MIMEType is the MIME type of the image (e.g., "image/jpeg")
 	MIMEType string
+	// Size is the length of the image data in bytes
+	Size int
 }
 
 // ReadProperties reads the audio properties from a file at the given path.
 func ReadProperties(path string) (Properties, error) {
+	return ReadPropertiesContext(context.Background(), path)
+}
+
+// ReadPropertiesContext is like [ReadProperties], but gives up once ctx is done.
+func ReadPropertiesContext(ctx context.Context, path string) (Properties, error) {
 	var err error
 	path, err = filepath.Abs(path)
 	if err != nil {
 		return Properties{}, fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModuleRO(dir)
+	mod, err := newModuleRO(path)
+	if err != nil {
+		return Properties{}, fmt.Errorf("init module: %w", err)
+	}
+	defer mod.release()
+
+	var raw wasmFileProperties
+	if err := mod.callContext(ctx, "taglib_file_read_properties", &raw, wasmString(wasmPath(path))); err != nil {
+		return Properties{}, fmt.Errorf("call: %w", err)
+	}
+	return raw.properties(), nil
+}
+
+// ReadAll reads normalized tags, format-specific tags and audio properties from the file at the
+// given path in a single pass.
+func ReadAll(path string) (Metadata, error) {
+	var err error
+	path, err = filepath.Abs(path)
+	if err != nil {
+		return Metadata{}, fmt.Errorf("make path abs %w", err)
+	}
+
+	mod, err := newModuleRO(path)
+	if err != nil {
+		return Metadata{}, fmt.Errorf("init module: %w", err)
+	}
+	defer mod.release()
+
+	var raw wasmReadAll
+	if err := mod.call("taglib_file_read_all", &raw, wasmString(wasmPath(path))); err != nil {
+		return Metadata{}, fmt.Errorf("call: %w", err)
+	}
+	if raw.tags == nil {
+		return Metadata{}, ErrInvalidFile
+	}
+	return raw.metadata(), nil
+}
+
+// TagsResult is the outcome of reading one file with [ReadTagsBatch].
+type TagsResult struct {
+	Path string
+	Tags map[string][]string
+	Err  error
+}
+
+// MetadataResult is the outcome of reading one file with [ReadAllBatch].
+type MetadataResult struct {
+	Path string
+	Metadata
+	Err error
+}
+
+// ReadTagsBatch reads the metadata tags of many files, like [ReadTags] on each path but
+// with far fewer calls into the module. Results are in the same order as paths. A file
+// that can't be read only sets the Err of its own result.
+func ReadTagsBatch(paths []string) []TagsResult {
+	return ReadTagsBatchContext(context.Background(), paths)
+}
+
+// ReadTagsBatchContext is like [ReadTagsBatch], but gives up once ctx is done. Files that
+// weren't read by then have the error of ctx.
+func ReadTagsBatchContext(ctx context.Context, paths []string) []TagsResult {
+	results := make([]TagsResult, len(paths))
+	for i, path := range paths {
+		results[i].Path = path
+	}
+	batchCall(ctx, paths, "taglib_file_tags_batch", func(m *module, i int, ptr uint32, err error) {
+		if err != nil {
+			results[i].Err = err
+			return
+		}
+		var tags wasmTags
+		tags.decode(m, uint64(ptr))
+		if tags == nil {
+			results[i].Err = ErrInvalidFile
+			return
+		}
+		results[i].Tags = tags
+	})
+	return results
+}
+
+// ReadAllBatch reads tags, format-specific tags and audio properties of many files, like
+// [ReadAll] on each path but with far fewer calls into the module. Results are in the same
+// order as paths. A file that can't be read only sets the Err of its own result.
+func ReadAllBatch(paths []string) []MetadataResult {
+	return ReadAllBatchContext(context.Background(), paths)
+}
+
+// ReadAllBatchContext is like [ReadAllBatch], but gives up once ctx is done. Files that
+// weren't read by then have the error of ctx.
+func ReadAllBatchContext(ctx context.Context, paths []string) []MetadataResult {
+	results := make([]MetadataResult, len(paths))
+	for i, path := range paths {
+		results[i].Path = path
+	}
+	batchCall(ctx, paths, "taglib_file_read_all_batch", func(m *module, i int, ptr uint32, err error) {
+		if err != nil {
+			results[i].Err = err
+			return
+		}
+		var raw wasmReadAll
+		raw.decode(m, uint64(ptr))
+		if raw.tags == nil {
+			results[i].Err = ErrInvalidFile
+			return
+		}
+		results[i].Metadata = raw.metadata()
+	})
+	return results
+}
+
+// batchChunkSize bounds how many files go into one batch call, and so how much guest
+// memory the results of a single call can need.
+const batchChunkSize = 64
+
+// batchCall passes paths to a batch export, grouped by their mount root and cut into chunks
+// of batchChunkSize, each run on one leased module. For every path, result is called with
+// the pointer the export returned for it, or with the error that kept it from being read.
+func batchCall(ctx context.Context, paths []string, export string, result func(m *module, i int, ptr uint32, err error)) {
+	byRoot := map[string][]int{}
+	var roots []string
+	abs := make([]string, len(paths))
+	for i, path := range paths {
+		var err error
+		abs[i], err = filepath.Abs(path)
+		if err != nil {
+			result(nil, i, 0, fmt.Errorf("make path abs %w", err))
+			continue
+		}
+		root := mountRoot(abs[i])
+		if _, ok := byRoot[root]; !ok {
+			roots = append(roots, root)
+		}
+		byRoot[root] = append(byRoot[root], i)
+	}
+
+	for _, root := range roots {
+		indices := byRoot[root]
+		for len(indices) > 0 {
+			chunk := indices[:min(len(indices), batchChunkSize)]
+			indices = indices[len(chunk):]
+			batchCallChunk(ctx, root, abs, chunk, export, result)
+		}
+	}
+}
+
+func batchCallChunk(ctx context.Context, root string, paths []string, chunk []int, export string, result func(m *module, i int, ptr uint32, err error)) {
+	fail := func(err error) {
+		for _, i := range chunk {
+			result(nil, i, 0, err)
+		}
+	}
+	if err := ctx.Err(); err != nil {
+		fail(err)
+		return
+	}
+
+	files := make([]string, len(chunk))
+	for j, i := range chunk {
+		files[j] = paths[i]
+	}
+	mod, err := leaseModule(root, true, files...)
+	if err != nil {
+		fail(fmt.Errorf("init module: %w", err))
+		return
+	}
+	defer mod.release()
+
+	filenames := make([]string, len(chunk))
+	for j, i := range chunk {
+		filenames[j] = wasmPath(paths[i])
+	}
+
+	var arrayPtr wasmUint32
+	if err := mod.callContext(ctx, export, &arrayPtr, wasmStrings(filenames)); err != nil {
+		fail(fmt.Errorf("call: %w", err))
+		return
+	}
+	if arrayPtr == 0 {
+		fail(ErrInvalidFile)
+		return
+	}
+	for j, i := range chunk {
+		ptr, ok := mod.mod.memory().ReadUint32Le(uint32(arrayPtr) + uint32(j*4))
+		if !ok {
+			panic("memory error")
+		}
+		result(mod, i, ptr, nil)
+	}
+}
+
+// ScanJob is a file for a [Scanner] to read, either from Path or, if it is set, from Reader.
+type ScanJob struct {
+	Path   string
+	Reader io.ReadSeeker
+	// Filename is a hint for format detection when reading from Reader, see [WithFilename]
+	Filename string
+}
+
+// ScanResult is the outcome of reading one [ScanJob].
+type ScanResult struct {
+	Job ScanJob
+	Metadata
+	Err error
+}
+
+// Scanner reads many files in parallel. Its workers take jobs from one shared queue, so
+// an idle worker always picks up the next job, and path jobs that are waiting are read
+// together with the batch API. Since results are sent on an unbuffered channel, a slow
+// consumer holds back the workers, which in turn stop taking jobs.
+type Scanner struct {
+	workers int
+}
+
+// ScannerOption configures a [Scanner].
+type ScannerOption func(*Scanner)
+
+// WithWorkers sets how many files a [Scanner] reads at once.
+// Default is runtime.GOMAXPROCS(0), which matches the default module pool size.
+func WithWorkers(n int) ScannerOption {
+	return func(s *Scanner) {
+		s.workers = max(n, 1)
+	}
+}
+
+// NewScanner returns a Scanner configured with opts.
+func NewScanner(opts ...ScannerOption) *Scanner {
+	s := &Scanner{workers: runtime.GOMAXPROCS(0)}
+	for _, opt := range opts {
+		opt(s)
+	}
+	return s
+}
+
+// Scan reads every job received on jobs until it's closed, and sends a result for each one
+// on the returned channel, in no particular order. The channel is closed once the last
+// result has been sent.
+func (s *Scanner) Scan(jobs <-chan ScanJob) <-chan ScanResult {
+	return s.ScanContext(context.Background(), jobs)
+}
+
+// ScanContext is like [Scanner.Scan], but gives up on reads once ctx is done. Jobs are
+// still taken until jobs is closed, and those left get ctx's error as their Err.
+func (s *Scanner) ScanContext(ctx context.Context, jobs <-chan ScanJob) <-chan ScanResult {
+	results := make(chan ScanResult)
+
+	var wg sync.WaitGroup
+	for i := 0; i < s.workers; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			s.work(ctx, jobs, results)
+		}()
+	}
+	go func() {
+		wg.Wait()
+		close(results)
+	}()
+	return results
+}
+
+func (s *Scanner) work(ctx context.Context, jobs <-chan ScanJob, results chan<- ScanResult) {
+	var batch []ScanJob
+	for job := range jobs {
+		// Take whatever else can be received without waiting, up to a batch call's worth.
+		// len(jobs) is always 0 on an unbuffered channel, so it can't size the batch.
+		batch = append(batch[:0], job)
+	drain:
+		for len(batch) < batchChunkSize {
+			select {
+			case next, ok := <-jobs:
+				if !ok {
+					break drain
+				}
+				batch = append(batch, next)
+			default:
+				break drain
+			}
+		}
+		scanBatch(ctx, batch, results)
+	}
+}
+
+func scanBatch(ctx context.Context, batch []ScanJob, results chan<- ScanResult) {
+	var paths []string
+	var pathJobs []ScanJob
+	for _, job := range batch {
+		if err := ctx.Err(); err != nil {
+			results <- ScanResult{Job: job, Err: err}
+			continue
+		}
+		if job.Reader != nil {
+			results <- scanReader(ctx, job)
+			continue
+		}
+		paths = append(paths, job.Path)
+		pathJobs = append(pathJobs, job)
+	}
+	if len(paths) == 0 {
+		return
+	}
+	for i, res := range ReadAllBatchContext(ctx, paths) {
+		results <- ScanResult{Job: pathJobs[i], Metadata: res.Metadata, Err: res.Err}
+	}
+}
+
+func scanReader(ctx context.Context, job ScanJob) ScanResult {
+	f, err := OpenStreamContext(ctx, job.Reader, WithFilename(job.Filename))
+	if err != nil {
+		return ScanResult{Job: job, Err: err}
+	}
+	defer func() { _ = f.Close() }()
+	md, err := f.ReadAllContext(ctx)
+	return ScanResult{Job: job, Metadata: md, Err: err}
+}
+
+// BatchEdit is a change for a [BatchWriter] to make to the file at Path. Edit makes it, with
+// the methods of the [Edit] it's given. It may be called more than once for a file, so it
+// must make the same changes each time.
+type BatchEdit struct {
+	Path string
+	Edit func(e *Edit)
+}
+
+// BatchResult is the outcome of writing the edits of one file with a [BatchWriter].
+type BatchResult struct {
+	Path string
+	WriteReport
+	// Edits is the number of edits of Path that were saved together
+	Edits int
+	Err   error
+}
+
+// Durability sets when a [BatchWriter] waits for what it wrote to reach the disk.
+type Durability uint8
+
+const (
+	// DurabilityNone leaves writing back to the OS, so files saved just before a crash may
+	// be lost. It's the only level that saves in place, and a file saved in place isn't
+	// crash-atomic: a crash partway through the write leaves it partly written.
+	DurabilityNone Durability = iota
+	// DurabilityFile syncs every file before its save counts as done. Every save goes through
+	// a rename, so a file is always whole, but the rename itself may be lost in a crash.
+	DurabilityFile
+	// DurabilityDirectory also syncs the directory of every file replaced through a rename,
+	// once per directory at the end of the batch
+	DurabilityDirectory
+)
+
+// BatchWriter saves edits to many files in parallel, with one save per file however many
+// edits are aimed at it. Files are read and written through streams, so every worker can use
+// a pooled module instance rather than setting one up with the file's directory mounted.
+//
+// Each file is first saved into an in-memory journal over the original. With [DurabilityNone],
+// if the save only overwrote bytes, as when the new tags fit their padding (see
+// [Edit.ReservePadding]), those bytes are written into the file in place. Otherwise the file
+// is copied to a temporary file next to it, saved there, and renamed over the original, so a
+// crash never leaves it half rewritten. The replacement keeps the permissions of the
+// original, but not its owner.
+type BatchWriter struct {
+	workers    int
+	durability Durability
+}
+
+// BatchWriterOption configures a [BatchWriter].
+type BatchWriterOption func(*BatchWriter)
+
+// WithWriteWorkers sets how many files a [BatchWriter] saves at once.
+// Default is runtime.GOMAXPROCS(0), which matches the default module pool size.
+func WithWriteWorkers(n int) BatchWriterOption {
+	return func(w *BatchWriter) {
+		w.workers = max(n, 1)
+	}
+}
+
+// WithDurability sets when a [BatchWriter] syncs what it wrote.
+// Default is [DurabilityFile].
+func WithDurability(d Durability) BatchWriterOption {
+	return func(w *BatchWriter) {
+		w.durability = d
+	}
+}
+
+// NewBatchWriter returns a BatchWriter configured with opts.
+func NewBatchWriter(opts ...BatchWriterOption) *BatchWriter {
+	w := &BatchWriter{workers: runtime.GOMAXPROCS(0), durability: DurabilityFile}
+	for _, opt := range opts {
+		opt(w)
+	}
+	return w
+}
+
+// Write saves edits and returns a result for each file they're aimed at, in the order the
+// files first appear in edits. The edits of one file are made to a single [Edit], in the
+// order given, so a later SetTags replaces an earlier one. A file that can't be saved only
+// sets the Err of its own result.
+func (w *BatchWriter) Write(edits []BatchEdit) []BatchResult {
+	var results []BatchResult
+	var groups [][]func(*Edit)
+	index := map[string]int{}
+	for _, e := range edits {
+		i, ok := index[e.Path]
+		if !ok {
+			i = len(results)
+			index[e.Path] = i
+			results = append(results, BatchResult{Path: e.Path})
+			groups = append(groups, nil)
+		}
+		groups[i] = append(groups[i], e.Edit)
+	}
+
+	jobs := make(chan int)
+	var renamed sync.Map // directory -> struct{}
+	var wg sync.WaitGroup
+	for i := 0; i < min(w.workers, len(results)); i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := range jobs {
+				r := &results[i]
+				r.Edits = len(groups[i])
+				var dir string
+				r.WriteReport, dir, r.Err = w.save(r.Path, groups[i])
+				if dir != "" {
+					renamed.Store(dir, struct{}{})
+				}
+			}
+		}()
+	}
+	for i := range results {
+		jobs <- i
+	}
+	close(jobs)
+	wg.Wait()
+
+	if w.durability >= DurabilityDirectory {
+		dirErrs := map[string]error{}
+		renamed.Range(func(dir, _ any) bool {
+			dirErrs[dir.(string)] = syncDir(dir.(string))
+			return true
+		})
+		for i := range results {
+			r := &results[i]
+			if r.Err == nil && !r.Unchanged && !r.InPlace {
+				if err := dirErrs[filepath.Dir(batchTarget(r.Path))]; err != nil {
+					r.Err = fmt.Errorf("sync dir: %w", err)
+				}
+			}
+		}
+	}
+	return results
+}
+
+// batchJournalLimit is the most a save may write into the journal. Saves that fit in place
+// only write the tags, so one that writes more is moving audio and goes through a rename.
+const batchJournalLimit = 8 << 20
+
+// save makes the edits of one file. If it replaced the file through a rename, it returns
+// the directory that has to be synced for the rename to last.
+func (w *BatchWriter) save(path string, edits []func(*Edit)) (WriteReport, string, error) {
+	path = batchTarget(path)
+	f, err := os.Open(path)
+	if err != nil {
+		return WriteReport{}, "", err
+	}
+	defer func() { _ = f.Close() }()
+	info, err := f.Stat()
+	if err != nil {
+		return WriteReport{}, "", err
+	}
+
+	j := &journal{r: f, size: info.Size(), base: info.Size(), limit: batchJournalLimit}
+	report, err := applyEdits(edits, func(opts ...OpenOption) (*File, error) {
+		opts = append(opts, WithWriterAt(j, j.truncate))
+		return OpenReaderAt(j, j.size, opts...)
+	}, path)
+	switch {
+	case err != nil && !j.overflow:
+		return WriteReport{}, "", err
+	case err == nil && report.Unchanged:
+		return report, "", nil
+	case err == nil && w.durability == DurabilityNone && j.inPlace(info.Size()):
+		// Overwriting the live file isn't atomic, so durable levels always rename
+		return WriteReport{InPlace: true}, "", writeJournal(path, j)
+	}
+
+	// The save resizes the file, moves its audio or has to be atomic, so it's made on a copy.
+	// If it wrote too much for the journal, it's made again there.
+	tmp, err := os.CreateTemp(filepath.Dir(path), "."+filepath.Base(path)+".*.tmp")
+	if err != nil {
+		return WriteReport{}, "", err
+	}
+	tmpPath := tmp.Name()
+	replaced := false
+	defer func() {
+		if !replaced {
+			_ = tmp.Close()
+			_ = os.Remove(tmpPath)
+		}
+	}()
+
+	if !j.overflow {
+		// The journal holds the whole save, so the copy can be the saved file
+		if _, err := io.Copy(tmp, io.NewSectionReader(j, 0, j.size)); err != nil {
+			return WriteReport{}, "", err
+		}
+	} else {
+		if _, err := io.Copy(tmp, io.NewSectionReader(f, 0, info.Size())); err != nil {
+			return WriteReport{}, "", err
+		}
+		_, err = applyEdits(edits, func(opts ...OpenOption) (*File, error) {
+			return OpenReadWriteStream(tmp, opts...)
+		}, path)
+		if err != nil {
+			return WriteReport{}, "", err
+		}
+	}
+	if err := tmp.Chmod(info.Mode().Perm()); err != nil {
+		return WriteReport{}, "", err
+	}
+	if w.durability >= DurabilityFile {
+		if err := tmp.Sync(); err != nil {
+			return WriteReport{}, "", err
+		}
+	}
+	if err := tmp.Close(); err != nil {
+		return WriteReport{}, "", err
+	}
+	if err := os.Rename(tmpPath, path); err != nil {
+		return WriteReport{}, "", err
+	}
+	replaced = true
+	return WriteReport{}, filepath.Dir(path), nil
+}
+
+// batchTarget returns the file path refers to, so a rename replaces it rather than the
+// symlink to it
+func batchTarget(path string) string {
+	if target, err := filepath.EvalSymlinks(path); err == nil {
+		return target
+	}
+	return path
+}
+
+// applyEdits opens a file with open, makes edits to it with a single save and closes it
+func applyEdits(edits []func(*Edit), open func(opts ...OpenOption) (*File, error), path string) (WriteReport, error) {
+	f, err := open(WithFilename(path), WithAudioProperties(false))
+	if err != nil {
+		return WriteReport{}, err
+	}
+	defer func() { _ = f.Close() }()
+
+	e := f.Edit()
+	for _, edit := range edits {
+		edit(e)
+	}
+	return e.Apply()
+}
+
+// writeJournal writes the bytes a save overwrote into the file at path
+func writeJournal(path string, j *journal) error {
+	f, err := os.OpenFile(path, os.O_WRONLY, 0)
+	if err != nil {
+		return err
+	}
+	for _, jw := range j.writes {
+		if _, err := f.WriteAt(jw.data, jw.off); err != nil {
+			_ = f.Close()
+			return err
+		}
+	}
+	return f.Close()
+}
+
+// journal is a file as a save left it, without touching the file: reads see the writes made
+// so far over the original. Writes beyond limit bytes in total fail, so a save that would
+// rewrite much of the file gives up rather than buffering it.
+type journal struct {
+	r        io.ReaderAt
+	size     int64 // current length
+	base     int64 // the original is only seen below this, after a truncate
+	limit    int
+	used     int
+	overflow bool
+	writes   []journalWrite // in the order they were made
+}
+
+type journalWrite struct {
+	off  int64
+	data []byte
+}
+
+// inPlace reports whether the save only overwrote bytes of a file of size bytes
+func (j *journal) inPlace(size int64) bool {
+	return !j.overflow && j.size == size && j.base == size
+}
+
+func (j *journal) ReadAt(p []byte, off int64) (int, error) {
+	if off >= j.size {
+		return 0, io.EOF
+	}
+	n := int(min(int64(len(p)), j.size-off))
+	buf := p[:n]
+	clear(buf)
+	if off < j.base {
+		if _, err := j.r.ReadAt(buf[:min(int64(n), j.base-off)], off); err != nil && err != io.EOF {
+			return 0, err
+		}
+	}
+	for _, w := range j.writes {
+		start, end := max(w.off, off), min(w.off+int64(len(w.data)), off+int64(n))
+		if start < end {
+			copy(buf[start-off:end-off], w.data[start-w.off:end-w.off])
+		}
+	}
+	if n < len(p) {
+		return n, io.EOF
+	}
+	return n, nil
+}
+
+func (j *journal) WriteAt(p []byte, off int64) (int, error) {
+	if j.used+len(p) > j.limit {
+		j.overflow = true
+		return 0, errJournalFull
+	}
+	j.used += len(p)
+	j.writes = append(j.writes, journalWrite{off, bytes.Clone(p)})
+	j.size = max(j.size, off+int64(len(p)))
+	return len(p), nil
+}
+
+func (j *journal) truncate(size int64) error {
+	j.size = size
+	j.base = min(j.base, size)
+	writes := j.writes[:0]
+	for _, w := range j.writes {
+		if w.off < size {
+			w.data = w.data[:min(int64(len(w.data)), size-w.off)]
+			writes = append(writes, w)
+		}
+	}
+	j.writes = writes
+	return nil
+}
+
+var errJournalFull = errors.New("journal full")
+
+// TagFingerprint hashes the bytes of the file at path that hold its tags, such as its ID3v2
+// tag, FLAC metadata blocks or MP4 udta atom, along with its length. It only reads those
+// regions and doesn't parse them, so it's much cheaper than reading the tags. Two
+// fingerprints differ if the tags were changed, so it tells a file that was only touched
+// apart from an edited one. It returns 0 if no tag region is known for the file's format.
+func TagFingerprint(path string) (uint64, error) {
+	var err error
+	path, err = filepath.Abs(path)
+	if err != nil {
+		return 0, fmt.Errorf("make path abs %w", err)
+	}
+
+	mod, err := newModuleRO(path)
+	if err != nil {
+		return 0, fmt.Errorf("init module: %w", err)
+	}
+	defer mod.release()
+
+	var fp wasmUint64
+	if err := mod.call("taglib_file_tag_fingerprint", &fp, wasmString(wasmPath(path))); err != nil {
+		return 0, fmt.Errorf("call: %w", err)
+	}
+	return uint64(fp), nil
+}
+
+// TagFingerprint is like [TagFingerprint] for an open file.
+func (f *File) TagFingerprint() uint64 {
+	var fp wasmUint64
+	if err := f.mod.call("taglib_handle_tag_fingerprint", &fp, wasmUint32(f.handle)); err != nil {
+		return 0
+	}
+	return uint64(fp)
+}
+
+// Cache keeps what [ReadAll] returned for files in an append-only log on disk, so that
+// reading a file that hasn't changed since is a single stat call. Files are matched by path,
+// size, modification time and inode. A file whose modification time changed but whose size,
+// inode and [TagFingerprint] didn't keeps its cached tags, as they're the same. The
+// fingerprint doesn't cover the audio, so its properties are read again.
+// A Cache is safe for concurrent use.
+type Cache struct {
+	mu      sync.Mutex
+	log     *os.File
+	path    string
+	entries map[string]cacheEntry
+}
+
+type cacheEntry struct {
+	Size        int64    `json:"size"`
+	ModTime     int64    `json:"mtime"`
+	Inode       uint64   `json:"inode"`
+	Fingerprint uint64   `json:"fp"`
+	Metadata    Metadata `json:"md"`
+}
+
+// cacheRecord is one line of the log
+type cacheRecord struct {
+	Path string `json:"path"`
+	cacheEntry
+}
+
+// OpenCache opens the cache log at path, creating it if needed. A record cut short by a
+// crash is dropped, and any other record that can't be decoded is skipped until [Cache.Compact]
+// rewrites the log without it. Close the Cache when done.
+func OpenCache(path string) (*Cache, error) {
+	log, err := os.OpenFile(path, os.O_RDWR|os.O_CREATE, 0o644)
+	if err != nil {
+		return nil, err
+	}
+	c := &Cache{log: log, path: path, entries: map[string]cacheEntry{}}
+	if err := c.load(); err != nil {
+		_ = log.Close()
+		return nil, fmt.Errorf("load cache: %w", err)
+	}
+	return c, nil
+}
+
+func (c *Cache) load() error {
+	var end int64
+	r := bufio.NewReader(c.log)
+	for {
+		line, err := r.ReadBytes('\n')
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return err
+		}
+		end += int64(len(line))
+		// A damaged line only loses its own record, not the ones after it
+		var rec cacheRecord
+		if json.Unmarshal(line, &rec) == nil {
+			c.entries[rec.Path] = rec.cacheEntry
+		}
+	}
+
+	// A last line without its newline is a torn write, appends continue from before it
+	if err := c.log.Truncate(end); err != nil {
+		return err
+	}
+	_, err := c.log.Seek(end, io.SeekStart)
+	return err
+}
+
+// ReadAll returns the metadata of the file at path like [ReadAll], from the cache if the
+// file hasn't changed since it was cached, or reading it and caching the result otherwise.
+// The returned Metadata is shared with the cache and must not be modified.
+func (c *Cache) ReadAll(path string) (Metadata, error) {
+	var err error
+	path, err = filepath.Abs(path)
+	if err != nil {
+		return Metadata{}, fmt.Errorf("make path abs %w", err)
+	}
+	info, err := os.Stat(path)
+	if err != nil {
+		return Metadata{}, err
+	}
+	entry := cacheEntry{Size: info.Size(), ModTime: info.ModTime().UnixNano(), Inode: fileInode(info)}
+
+	c.mu.Lock()
+	cached, ok := c.entries[path]
+	c.mu.Unlock()
+
+	if ok && cached.Size == entry.Size && cached.Inode == entry.Inode {
+		if cached.ModTime == entry.ModTime {
+			return cached.Metadata, nil
+		}
+		// Touched, or edited in place. The tags only need reading again if they changed,
+		// but the audio may have been rewritten at the same size
+		if cached.Fingerprint != 0 {
+			if props, ok, err := readPropertiesIfFingerprint(path, cached.Fingerprint); err == nil && ok {
+				cached.ModTime = entry.ModTime
+				cached.Metadata.Properties = props
+				return cached.Metadata, c.put(path, cached)
+			}
+		}
+	}
+
+	entry.Metadata, entry.Fingerprint, err = readAllFingerprint(path)
+	if err != nil {
+		return Metadata{}, err
+	}
+	return entry.Metadata, c.put(path, entry)
+}
+
+// readAllFingerprint is ReadAll and TagFingerprint with a single module lease
+func readAllFingerprint(path string) (Metadata, uint64, error) {
+	mod, err := newModuleRO(path)
+	if err != nil {
+		return Metadata{}, 0, fmt.Errorf("init module: %w", err)
+	}
+	defer mod.release()
+
+	var raw wasmReadAll
+	if err := mod.call("taglib_file_read_all", &raw, wasmString(wasmPath(path))); err != nil {
+		return Metadata{}, 0, fmt.Errorf("call: %w", err)
+	}
+	if raw.tags == nil {
+		return Metadata{}, 0, ErrInvalidFile
+	}
+	var fp wasmUint64
+	if err := mod.call("taglib_file_tag_fingerprint", &fp, wasmString(wasmPath(path))); err != nil {
+		return Metadata{}, 0, fmt.Errorf("call: %w", err)
+	}
+	return raw.metadata(), uint64(fp), nil
+}
+
+// readPropertiesIfFingerprint is ReadProperties with a single module lease, if the tag
+// fingerprint of path is still fp. It reports false otherwise.
+func readPropertiesIfFingerprint(path string, fp uint64) (Properties, bool, error) {
+	mod, err := newModuleRO(path)
+	if err != nil {
+		return Properties{}, false, fmt.Errorf("init module: %w", err)
+	}
+	defer mod.release()
+
+	var got wasmUint64
+	if err := mod.call("taglib_file_tag_fingerprint", &got, wasmString(wasmPath(path))); err != nil {
+		return Properties{}, false, fmt.Errorf("call: %w", err)
+	}
+	if uint64(got) != fp {
+		return Properties{}, false, nil
+	}
+	var raw wasmFileProperties
+	if err := mod.call("taglib_file_read_properties", &raw, wasmString(wasmPath(path))); err != nil {
+		return Properties{}, false, fmt.Errorf("call: %w", err)
+	}
+	return raw.properties(), true, nil
+}
+
+func (c *Cache) put(path string, entry cacheEntry) error {
+	line, err := json.Marshal(cacheRecord{Path: path, cacheEntry: entry})
+	if err != nil {
+		return err
+	}
+	line = append(line, '\n')
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	c.entries[path] = entry
+	_, err = c.log.Write(line)
+	return err
+}
+
+// Compact rewrites the log with one record per file, dropping replaced records and files
+// that no longer exist. The new log replaces the old one atomically.
+func (c *Cache) Compact() error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	tmp, err := os.CreateTemp(filepath.Dir(c.path), filepath.Base(c.path)+".*")
 	if err != nil {
-		return Properties{}, fmt.Errorf("init module: %w", err)
-	}
-	defer mod.close()
-
-	var raw wasmFileProperties
-	if err := mod.call("taglib_file_read_properties", &raw, wasmString(wasmPath(path))); err != nil {
-		return Properties{}, fmt.Errorf("call: %w", err)
+		return err
 	}
+	defer func() { _ = os.Remove(tmp.Name()) }()
 
-	var images []ImageDesc
-	for _, row := range raw.imageDescs {
-		parts := strings.SplitN(row, "\t", 3)
-		if len(parts) != 3 {
+	w := bufio.NewWriter(tmp)
+	for path, entry := range c.entries {
+		if _, err := os.Stat(path); errors.Is(err, os.ErrNotExist) {
+			delete(c.entries, path)
 			continue
 		}
-		images = append(images, ImageDesc{
-			Type:        parts[0],
-			Description: parts[1],
-			MIMEType:    parts[2],
-		})
+		line, err := json.Marshal(cacheRecord{Path: path, cacheEntry: entry})
+		if err != nil {
+			_ = tmp.Close()
+			return err
+		}
+		_, _ = w.Write(append(line, '\n'))
+	}
+	if err := w.Flush(); err != nil {
+		_ = tmp.Close()
+		return err
+	}
+	if err := tmp.Sync(); err != nil {
+		_ = tmp.Close()
+		return err
+	}
+	if err := os.Rename(tmp.Name(), c.path); err != nil {
+		_ = tmp.Close()
+		return err
 	}
 
-	return Properties{
-		Length:        time.Duration(raw.lengthInMilliseconds) * time.Millisecond,
-		Channels:      uint(raw.channels),
-		SampleRate:    uint(raw.sampleRate),
-		Bitrate:       uint(raw.bitrate),
-		BitsPerSample: uint(raw.bitsPerSample),
-		Codec:         raw.codec,
-		Images:        images,
-	}, nil
+	_ = c.log.Close()
+	c.log = tmp
+	_, err = c.log.Seek(0, io.SeekEnd)
+	return err
+}
+
+// Close closes the cache log.
+func (c *Cache) Close() error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.log.Close()
 }
 
 // WriteOption configures the behavior of write operations. The can be passed to [WriteTags] and combined with the bitwise OR operator.
@@ -796,6 +2509,7 @@ const (
 )
 
 // WriteTags writes the metadata key-values pairs to path. The behavior can be controlled with [WriteOption].
+// If the file already has exactly these tags, it's left untouched.
 func WriteTags(path string, tags map[string][]string, opts WriteOption) error {
 	var err error
 	path, err = filepath.Abs(path)
@@ -803,23 +2517,19 @@ func WriteTags(path string, tags map[string][]string, opts WriteOption) error {
 		return fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModule(dir)
+	mod, err := newModule(path)
 	if err != nil {
 		return fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
-	var raw []string
-	for k, vs := range tags {
-		raw = append(raw, fmt.Sprintf("%s\t%s", k, strings.Join(vs, "\v")))
-	}
+	raw := tagRows(tags)
 
-	var out wasmBool
+	var out writeStatus
 	if err := mod.call("taglib_file_write_tags", &out, wasmString(wasmPath(path)), wasmStrings(raw), wasmUint8(opts)); err != nil {
 		return fmt.Errorf("call: %w", err)
 	}
-	if !out {
+	if out == writeFailed {
 		return ErrSavingFile
 	}
 	return nil
@@ -836,24 +2546,20 @@ func WriteID3v2Frames(path string, frames map[string][]string, opts WriteOption)
 		return fmt.Errorf("make path abs %w", err)
 	}
 
-	dir := filepath.Dir(path)
-	mod, err := newModule(dir)
+	mod, err := newModule(path)
 	if err != nil {
 		return fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
 	// Convert the frames map to a slice of strings
-	var framesList []string
-	for k, vs := range frames {
-		framesList = append(framesList, fmt.Sprintf("%s\t%s", k, strings.Join(vs, "\v")))
-	}
+	framesList := tagRows(frames)
 
-	var out wasmBool
+	var out writeStatus
 	if err := mod.call("taglib_file_write_id3v2_frames", &out, wasmString(wasmPath(path)), wasmStrings(framesList), wasmUint8(opts)); err != nil {
 		return fmt.Errorf("call: %w", err)
 	}
-	if !out {
+	if out == writeFailed {
 		return ErrSavingFile
 	}
 
@@ -884,11 +2590,11 @@ func ReadImageOptions(path string, index int) ([]byte, error) {
 		return nil, fmt.Errorf("make path abs %w", err)
 	}
 
-	mod, err := newModuleRO(filepath.Dir(path))
+	mod, err := newModuleRO(path)
 	if err != nil {
 		return nil, fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
 	var img wasmBytes
 	if err := mod.call("taglib_file_read_image", &img, wasmString(wasmPath(path)), wasmInt(index)); err != nil {
@@ -908,93 +2614,161 @@ func WriteImageOptions(path string, image []byte, index int, imageType, descript
 		return fmt.Errorf("make path abs %w", err)
 	}
 
-	mod, err := newModule(filepath.Dir(path))
+	mod, err := newModule(path)
 	if err != nil {
 		return fmt.Errorf("init module: %w", err)
 	}
-	defer mod.close()
+	defer mod.release()
 
-	var out wasmBool
+	var out writeStatus
 	if err := mod.call("taglib_file_write_image", &out, wasmString(wasmPath(path)), wasmBytes(image), wasmInt(len(image)), wasmInt(index), wasmString(imageType), wasmString(description), wasmString(mimeType)); err != nil {
 		return fmt.Errorf("call: %w", err)
 	}
-	if !out {
+	if out == writeFailed {
 		return ErrSavingFile
 	}
 	return nil
 }
 
-type rc struct {
-	wazero.Runtime
-	wazero.CompiledModule
-}
-
-// Stream registry for io.ReadSeeker streams used by OpenStream
+// Stream registry for the readers used by OpenStream and OpenReaderAt. Streams are looked up
+// on every host read, which sync.Map serves without contention.
 var (
-	streamRegistry   = make(map[uint32]io.ReadSeeker)
-	streamRegistryMu sync.RWMutex
-	nextStreamId     uint32 = 1
+	streamRegistry sync.Map // uint32 -> io.ReadSeeker, readWriteStream or readerAtStream
+	nextStreamId   atomic.Uint32
 )
 
-// Buffer pool for stream reads - avoids allocation per read call
-var streamReadPool = sync.Pool{
-	New: func() any {
-		// Match C++ BUFFER_SIZE (32KB)
-		buf := make([]byte, 32*1024)
-		return &buf
-	},
-}
-
-func registerStream(r io.ReadSeeker) uint32 {
-	streamRegistryMu.Lock()
-	defer streamRegistryMu.Unlock()
-	id := nextStreamId
-	nextStreamId++
-	streamRegistry[id] = r
+// readerAtStream marks a stream registered by OpenReaderAt, so that only stream_pread uses it.
+// w and truncate are set if it was opened with WithWriterAt.
+type readerAtStream struct {
+	io.ReaderAt
+	w        io.WriterAt
+	truncate func(size int64) error
+}
+
+// readWriteStream marks a stream registered by OpenReadWriteStream, so that only it gets written.
+type readWriteStream struct{ io.ReadWriteSeeker }
+
+func registerStream(r any) uint32 {
+	id := nextStreamId.Add(1)
+	streamRegistry.Store(id, r)
 	return id
 }
 
 func unregisterStream(id uint32) {
-	streamRegistryMu.Lock()
-	defer streamRegistryMu.Unlock()
-	delete(streamRegistry, id)
+	streamRegistry.Delete(id)
 }
 
 func getStream(id uint32) io.ReadSeeker {
-	streamRegistryMu.RLock()
-	defer streamRegistryMu.RUnlock()
-	return streamRegistry[id]
+	v, _ := streamRegistry.Load(id)
+	r, _ := v.(io.ReadSeeker)
+	return r
+}
+
+func getReaderAt(id uint32) io.ReaderAt {
+	v, _ := streamRegistry.Load(id)
+	r, ok := v.(readerAtStream)
+	if !ok {
+		return nil
+	}
+	return r.ReaderAt
 }
 
-// Host functions called by WASM for stream I/O
-func hostStreamRead(_ context.Context, m api.Module, streamId, bufPtr, length uint32) uint32 {
+// startHostIO returns the configured Metrics and, if there is one, the start time of a host
+// I/O operation to report to it.
+func startHostIO() (Metrics, time.Time) {
+	mt := getMetrics()
+	if mt == nil {
+		return nil, time.Time{}
+	}
+	return mt, time.Now()
+}
+
+// Host functions called by the module for stream I/O. The backend passes buf as a view of
+// the module's own buffer, so reads land in it without another copy. Once ctx, the context
+// of the call, is done, reads come back empty so the module gives up on the stream.
+func hostStreamRead(ctx context.Context, streamId uint32, buf []byte) uint32 {
 	r := getStream(streamId)
-	if r == nil {
+	if r == nil || ctx.Err() != nil {
 		return 0
 	}
 
-	// Use pooled buffer to avoid allocation
-	bufp := streamReadPool.Get().(*[]byte)
-	buf := *bufp
-	defer streamReadPool.Put(bufp)
+	// Fill the whole buffer, so a short read only happens at the end of the stream
+	mt, start := startHostIO()
+	n, _ := io.ReadFull(r, buf)
+	if mt != nil {
+		mt.HostIO(HostIOInfo{Op: HostRead, Bytes: int64(n), Duration: time.Since(start)})
+	}
+	return uint32(n)
+}
+
+func hostStreamPread(ctx context.Context, streamId uint32, offset int64, buf []byte) uint32 {
+	r := getReaderAt(streamId)
+	if r == nil || ctx.Err() != nil {
+		return 0
+	}
 
-	// Read up to buffer size
-	toRead := length
-	if toRead > uint32(len(buf)) {
-		toRead = uint32(len(buf))
+	// ReadAt only returns short at the end of the stream or on error
+	mt, start := startHostIO()
+	n, _ := r.ReadAt(buf, offset)
+	if mt != nil {
+		mt.HostIO(HostIOInfo{Op: HostReadAt, Bytes: int64(n), Duration: time.Since(start)})
 	}
+	return uint32(n)
+}
 
-	n, err := r.Read(buf[:toRead])
-	if err != nil && n == 0 {
+func hostStreamPwrite(streamId uint32, offset int64, buf []byte) uint32 {
+	mt, start := startHostIO()
+	var n int
+	v, _ := streamRegistry.Load(streamId)
+	switch s := v.(type) {
+	case readerAtStream:
+		if s.w == nil {
+			return 0
+		}
+		n, _ = s.w.WriteAt(buf, offset)
+	case readWriteStream:
+		if _, err := s.Seek(offset, io.SeekStart); err != nil {
+			return 0
+		}
+		n, _ = s.Write(buf)
+	default:
 		return 0
 	}
-	if n > 0 {
-		m.Memory().Write(bufPtr, buf[:n])
+	if mt != nil {
+		mt.HostIO(HostIOInfo{Op: HostWrite, Bytes: int64(n), Duration: time.Since(start)})
 	}
 	return uint32(n)
 }
 
-func hostStreamSeek(_ context.Context, streamId uint32, offset int64, whence int32) int32 {
+func hostStreamTruncate(streamId uint32, length int64) int32 {
+	mt, start := startHostIO()
+	var err error
+	v, _ := streamRegistry.Load(streamId)
+	switch s := v.(type) {
+	case readerAtStream:
+		if s.w == nil || s.truncate == nil {
+			return -1
+		}
+		err = s.truncate(length)
+	case readWriteStream:
+		t, ok := s.ReadWriteSeeker.(interface{ Truncate(size int64) error })
+		if !ok {
+			return -1
+		}
+		err = t.Truncate(length)
+	default:
+		return -1
+	}
+	if mt != nil {
+		mt.HostIO(HostIOInfo{Op: HostTruncate, Bytes: length, Duration: time.Since(start)})
+	}
+	if err != nil {
+		return -1
+	}
+	return 0
+}
+
+func hostStreamSeek(streamId uint32, offset int64, whence int32) int32 {
 	r := getStream(streamId)
 	if r == nil {
 		return -1
@@ -1006,7 +2780,7 @@ func hostStreamSeek(_ context.Context, streamId uint32, offset int64, whence int
 	return 0
 }
 
-func hostStreamTell(_ context.Context, streamId uint32) int64 {
+func hostStreamTell(streamId uint32) int64 {
 	r := getStream(streamId)
 	if r == nil {
 		return -1
@@ -1018,7 +2792,7 @@ func hostStreamTell(_ context.Context, streamId uint32) int64 {
 	return pos
 }
 
-func hostStreamLength(_ context.Context, streamId uint32) int64 {
+func hostStreamLength(streamId uint32) int64 {
 	r := getStream(streamId)
 	if r == nil {
 		return -1
@@ -1038,116 +2812,218 @@ func hostStreamLength(_ context.Context, streamId uint32) int64 {
 	return end
 }
 
-var getRuntimeOnce = sync.OnceValues(func() (rc, error) {
-	ctx := context.Background()
+// instance is a running copy of the module, from the backend the package was built with:
+// wazero by default, or TagLib linked in through cgo with the taglib_native build tag.
+type instance interface {
+	memory() memory
+	call(ctx context.Context, name string, params ...uint64) ([]uint64, error)
+	close() error
+}
 
-	cacheDir := filepath.Join(os.TempDir(), "go-taglib-wasm")
-	compilationCache, err := wazero.NewCompilationCacheWithDir(cacheDir)
-	if err != nil {
-		return rc{}, err
-	}
+// memory is the address space that call arguments and results are passed through. Offsets
+// are 32 bits wide on both backends, so results have the same layout.
+type memory interface {
+	Read(offset, byteCount uint32) ([]byte, bool)
+	ReadUint32Le(offset uint32) (uint32, bool)
+	ReadUint64Le(offset uint32) (uint64, bool)
+	Write(offset uint32, v []byte) bool
+	WriteUint32Le(offset, v uint32) bool
+	Size() uint32
+}
 
-	runtime := wazero.NewRuntimeWithConfig(ctx,
-		wazero.NewRuntimeConfig().
-			WithCompilationCache(compilationCache),
-	)
-	wasi_snapshot_preview1.MustInstantiate(ctx, runtime)
+type module struct {
+	mod     instance
+	pool    *modulePool
+	broken  bool       // a call failed, so the instance can't be trusted for another lease
+	format  FileFormat // of the File holding the lease, for Metrics
+	limited bool       // memory has a limit, so calls listen for the guest running out
+	fs      *leaseFS   // what the instance mounts, if it's pooled and has a root
+}
 
-	_, err = runtime.
-		NewHostModuleBuilder("env").
-		NewFunctionBuilder().WithFunc(func(int32) int32 { panic("__cxa_allocate_exception") }).Export("__cxa_allocate_exception").
-		NewFunctionBuilder().WithFunc(func(int32, int32, int32) { panic("__cxa_throw") }).Export("__cxa_throw").
-		Instantiate(ctx)
-	if err != nil {
-		return rc{}, err
-	}
+func newModule(path string) (*module, error)   { return leaseModule(filepath.Dir(path), false) }
+func newModuleRO(path string) (*module, error) { return leaseModule(mountRoot(path), true, path) }
+func newModuleForStream() (*module, error)     { return leaseModule("", true) }
 
-	// Register stream I/O host functions for OpenStream support
-	_, err = runtime.
-		NewHostModuleBuilder("go_io").
-		NewFunctionBuilder().WithFunc(hostStreamRead).Export("stream_read").
-		NewFunctionBuilder().WithFunc(hostStreamSeek).Export("stream_seek").
-		NewFunctionBuilder().WithFunc(hostStreamTell).Export("stream_tell").
-		NewFunctionBuilder().WithFunc(hostStreamLength).Export("stream_length").
-		Instantiate(ctx)
-	if err != nil {
-		return rc{}, err
+// mountRoot returns the filesystem root containing path. Read-only modules are mounted at
+// the whole root rather than the file's directory, so that one pooled instance can serve
+// any file, but they only see what leaseFS lets through. Writable modules only mount the
+// directory they write to, see leaseModule.
+func mountRoot(path string) string {
+	return filepath.VolumeName(path) + string(filepath.Separator)
+}
+
+// leaseFS is the filesystem a pooled read-only instance mounts at root. The instance
+// outlives its leases, so rather than the whole volume it only exposes the directories of
+// the files the current lease was taken for, as a mount of each directory would. Leases
+// are exclusive, so dirs needs no lock.
+type leaseFS struct {
+	root string
+	dirs []string
+}
+
+// allow limits l to the directories of paths, or to nothing if there are none.
+func (l *leaseFS) allow(paths ...string) {
+	l.dirs = l.dirs[:0]
+	for _, path := range paths {
+		l.dirs = append(l.dirs, filepath.Dir(path))
 	}
+}
 
-	var bin = binary
-	if binaryPath != "" {
-		bin, err = os.ReadFile(binaryPath)
+func (l *leaseFS) Open(name string) (fs.File, error) {
+	if !fs.ValidPath(name) {
+		return nil, &fs.PathError{Op: "open", Path: name, Err: fs.ErrInvalid}
+	}
+	path := filepath.Join(l.root, filepath.FromSlash(name))
+	if name == "." {
+		f, err := os.Open(path)
 		if err != nil {
-			return rc{}, fmt.Errorf("read custom binary path: %w", err)
+			return nil, err
 		}
-		clear(binary)
+		// Hides ReadDir, so the entries of the volume can't be listed
+		return struct{ fs.File }{f}, nil
 	}
-
-	compiled, err := runtime.CompileModule(ctx, bin)
-	if err != nil {
-		return rc{}, err
+	if !slices.Contains(l.dirs, path) && !slices.Contains(l.dirs, filepath.Dir(path)) {
+		return nil, &fs.PathError{Op: "open", Path: name, Err: fs.ErrNotExist}
 	}
+	return os.Open(path)
+}
 
-	return rc{
-		Runtime:        runtime,
-		CompiledModule: compiled,
-	}, nil
-})
+// modulePool keeps initialised module instances with the same mount for reuse. Instances are
+// leased exclusively and reset by the guest before they go back, so no state leaks between leases.
+type modulePool struct {
+	root     string // mounted at its own path in the guest. If empty, no filesystem access is provided
+	readOnly bool   // false for a writable module, whose pool never keeps it
 
-type module struct {
-	mod api.Module
+	mu   sync.Mutex
+	idle []*module
 }
 
-func newModule(dir string) (module, error)   { return newModuleOpt(dir, false) }
-func newModuleRO(dir string) (module, error) { return newModuleOpt(dir, true) }
-func newModuleForStream() (module, error)    { return newModuleOpt("", true) }
+// pools holds the read-only pool of each mount root
+var (
+	pools   = map[string]*modulePool{}
+	poolsMu sync.Mutex
+)
 
-// newModuleOpt creates a module with optional directory mount. If dir is empty, no filesystem access is provided.
-func newModuleOpt(dir string, readOnly bool) (module, error) {
-	rt, err := getRuntimeOnce()
-	if err != nil {
-		return module{}, fmt.Errorf("get runtime once: %w", err)
+func getPool(root string) *modulePool {
+	poolsMu.Lock()
+	defer poolsMu.Unlock()
+	p, ok := pools[root]
+	if !ok {
+		p = &modulePool{root: root, readOnly: true}
+		pools[root] = p
 	}
+	return p
+}
 
-	cfg := wazero.
-		NewModuleConfig().
-		WithName("").
-		WithStartFunctions("_initialize")
-
-	if dir != "" {
-		fsConfig := wazero.NewFSConfig()
-		if readOnly {
-			fsConfig = fsConfig.WithReadOnlyDirMount(dir, wasmPath(dir))
-		} else {
-			fsConfig = fsConfig.WithDirMount(dir, wasmPath(dir))
+// leaseModule returns an idle module from the pool for root, or instantiates a new one.
+// The module must be given back with [module.release]. A read-only module only sees the
+// directories of files.
+//
+// Writable modules aren't pooled: each gets an instance of its own with only root mounted,
+// which is closed on release, so write access never outlives the call that needed it.
+// Streams are written through the host, so their modules are pooled like read-only ones.
+func leaseModule(root string, readOnly bool, files ...string) (*module, error) {
+	if !readOnly {
+		return (&modulePool{root: root}).instantiate()
+	}
+	p := getPool(root)
+
+	p.mu.Lock()
+	var m *module
+	if n := len(p.idle); n > 0 {
+		m = p.idle[n-1]
+		p.idle = p.idle[:n-1]
+	}
+	p.mu.Unlock()
+
+	if m == nil {
+		var err error
+		if m, err = p.instantiate(); err != nil {
+			return nil, err
 		}
-		cfg = cfg.WithFSConfig(fsConfig)
 	}
+	if m.fs != nil {
+		m.fs.allow(files...)
+	}
+	return m, nil
+}
 
-	ctx := context.Background()
-	mod, err := rt.InstantiateModule(ctx, rt.CompiledModule, cfg)
+func (p *modulePool) instantiate() (*module, error) {
+	mt := getMetrics()
+	var start time.Time
+	if mt != nil {
+		start = time.Now()
+	}
+	var lease *leaseFS
+	if p.readOnly && p.root != "" {
+		lease = &leaseFS{root: p.root}
+	}
+	mod, err := newInstance(p.root, p.readOnly, lease)
+	if mt != nil {
+		mt.Instantiate(time.Since(start), err)
+	}
 	if err != nil {
-		return module{}, err
+		return nil, err
 	}
 
-	return module{
-		mod: mod,
+	return &module{
+		mod:     mod,
+		pool:    p,
+		limited: getConfig().memoryLimitPages > 0,
+		fs:      lease,
 	}, nil
 }
 
-func (m *module) malloc(size uint32) uint32 {
-	var ptr wasmUint32
-	if err := m.call("malloc", &ptr, wasmUint32(size)); err != nil {
-		panic(err)
+// put returns m to the idle list, or reports false if the pool is already full or m is
+// writable.
+func (p *modulePool) put(m *module) bool {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	if !p.readOnly || len(p.idle) >= getConfig().poolSize {
+		return false
+	}
+	p.idle = append(p.idle, m)
+	return true
+}
+
+// trim closes idle modules beyond size.
+func (p *modulePool) trim(size int) {
+	p.mu.Lock()
+	var extra []*module
+	if len(p.idle) > size {
+		extra = append(extra, p.idle[size:]...)
+		clear(p.idle[size:])
+		p.idle = p.idle[:size]
+	}
+	p.mu.Unlock()
+
+	for _, m := range extra {
+		m.close()
+	}
+}
+
+// malloc allocates an argument buffer for the next call. It goes straight to the export
+// rather than through call, as every argument of a call has to stay in the arena until the
+// call has run.
+func (m *module) malloc(ctx context.Context, size uint32) (uint32, error) {
+	res, err := m.mod.call(ctx, "malloc", uint64(size))
+	if err != nil {
+		return 0, err
 	}
-	if ptr == 0 {
-		panic("no ptr")
+	if len(res) == 0 || uint32(res[0]) == 0 {
+		return 0, errArgumentAlloc
 	}
-	return uint32(ptr)
+	return uint32(res[0]), nil
 }
 
+// errArgumentAlloc is returned for a call whose arguments the module had no memory for
+var errArgumentAlloc = errors.New("can't allocate argument")
+
+// errArgumentWrite is returned for a call whose arguments couldn't be written to the module
+var errArgumentWrite = errors.New("can't write argument")
+
 type wasmArg interface {
-	encode(*module) uint64
+	encode(ctx context.Context, m *module) (uint64, error)
 }
 
 type wasmResult interface {
@@ -1156,44 +3032,69 @@ type wasmResult interface {
 
 type wasmBool bool
 
-func (b wasmBool) encode(*module) uint64 {
+func (b wasmBool) encode(context.Context, *module) (uint64, error) {
 	if b {
-		return 1
+		return 1, nil
 	}
-	return 0
+	return 0, nil
 }
 
 func (b *wasmBool) decode(_ *module, val uint64) {
 	*b = val == 1
 }
 
+// writeStatus is the result of the write exports. Must match C++'s WriteStatus
+type writeStatus uint8
+
+const (
+	writeFailed       writeStatus = 0
+	writeSaved        writeStatus = 1
+	writeUnchanged    writeStatus = 2 // the file already had the changes, so it wasn't saved
+	writeSavedInPlace writeStatus = 3 // saved without changing the file's length
+	writePaddingLeft  writeStatus = 4 // saved, but the placeholder of Edit.ReservePadding is still in the tag
+)
+
+func (s *writeStatus) decode(_ *module, val uint64) {
+	*s = writeStatus(val)
+}
+
 type wasmInt int
 
-func (i wasmInt) encode(*module) uint64 { return uint64(i) }
+func (i wasmInt) encode(context.Context, *module) (uint64, error) { return uint64(i), nil }
 func (i *wasmInt) decode(_ *module, val uint64) {
 	*i = wasmInt(val)
 }
 
+// wasmNull is a null pointer argument, for leaving out an optional parameter.
+type wasmNull struct{}
+
+func (wasmNull) encode(context.Context, *module) (uint64, error) { return 0, nil }
+
+type wasmInt64 int64
+
+func (i wasmInt64) encode(context.Context, *module) (uint64, error) { return uint64(i), nil }
+
+type wasmUint64 uint64
+
+func (u *wasmUint64) decode(_ *module, val uint64) {
+	*u = wasmUint64(val)
+}
+
 type wasmUint8 uint8
 
-func (u wasmUint8) encode(*module) uint64 { return uint64(u) }
+func (u wasmUint8) encode(context.Context, *module) (uint64, error) { return uint64(u), nil }
 
 type wasmUint32 uint32
 
-func (u wasmUint32) encode(*module) uint64 { return uint64(u) }
+func (u wasmUint32) encode(context.Context, *module) (uint64, error) { return uint64(u), nil }
 func (u *wasmUint32) decode(_ *module, val uint64) {
 	*u = wasmUint32(val)
 }
 
 type wasmString string
 
-func (s wasmString) encode(m *module) uint64 {
-	b := append([]byte(s), 0)
-	ptr := m.malloc(uint32(len(b)))
-	if !m.mod.Memory().Write(ptr, b) {
-		panic("failed to write to mod.module.Memory()")
-	}
-	return uint64(ptr)
+func (s wasmString) encode(ctx context.Context, m *module) (uint64, error) {
+	return wasmBytes(append([]byte(s), 0)).encode(ctx, m)
 }
 func (s *wasmString) decode(m *module, val uint64) {
 	if val != 0 {
@@ -1203,12 +3104,15 @@ func (s *wasmString) decode(m *module, val uint64) {
 
 type wasmBytes []byte
 
-func (b wasmBytes) encode(m *module) uint64 {
-	ptr := m.malloc(uint32(len(b)))
-	if !m.mod.Memory().Write(ptr, b) {
-		panic("failed to write to mod.module.Memory()")
+func (b wasmBytes) encode(ctx context.Context, m *module) (uint64, error) {
+	ptr, err := m.malloc(ctx, uint32(len(b)))
+	if err != nil {
+		return 0, err
 	}
-	return uint64(ptr)
+	if !m.mod.memory().Write(ptr, b) {
+		return 0, errArgumentWrite
+	}
+	return uint64(ptr), nil
 }
 func (b *wasmBytes) decode(m *module, val uint64) {
 	if val != 0 {
@@ -1216,28 +3120,88 @@ func (b *wasmBytes) decode(m *module, val uint64) {
 	}
 }
 
+// wasmView is a ByteData result that is left in guest memory rather than copied out. It's
+// only valid until the next call into the module.
+type wasmView []byte
+
+func (v *wasmView) decode(m *module, val uint64) {
+	if val != 0 {
+		*v = viewBytes(m, uint32(val))
+	}
+}
+
 type wasmStrings []string
 
-func (s wasmStrings) encode(m *module) uint64 {
-	arrayPtr := m.malloc(uint32((len(s) + 1) * 4))
+func (s wasmStrings) encode(ctx context.Context, m *module) (uint64, error) {
+	arrayPtr, err := m.malloc(ctx, uint32((len(s)+1)*4))
+	if err != nil {
+		return 0, err
+	}
 	for i, str := range s {
-		b := append([]byte(str), 0)
-		ptr := m.malloc(uint32(len(b)))
-		if !m.mod.Memory().Write(ptr, b) {
-			panic("failed to write to mod.module.Memory()")
+		ptr, err := wasmString(str).encode(ctx, m)
+		if err != nil {
+			return 0, err
 		}
-		if !m.mod.Memory().WriteUint32Le(arrayPtr+uint32(i*4), ptr) {
-			panic("failed to write pointer to mod.module.Memory()")
+		if !m.mod.memory().WriteUint32Le(arrayPtr+uint32(i*4), uint32(ptr)) {
+			return 0, errArgumentWrite
 		}
 	}
-	if !m.mod.Memory().WriteUint32Le(arrayPtr+uint32(len(s)*4), 0) {
-		panic("failed to write pointer to memory")
+	if !m.mod.memory().WriteUint32Le(arrayPtr+uint32(len(s)*4), 0) {
+		return 0, errArgumentWrite
 	}
-	return uint64(arrayPtr)
+	return uint64(arrayPtr), nil
 }
-func (s *wasmStrings) decode(m *module, val uint64) {
-	if val != 0 {
-		*s = readStrings(m, uint32(val))
+
+// wasmTags is a guest result buffer of key, value rows grouped into a multi-valued map.
+// It stays nil if the guest returns a null pointer, and is empty if the buffer has no rows.
+type wasmTags map[string][]string
+
+func (t *wasmTags) decode(m *module, val uint64) {
+	if val == 0 {
+		return
+	}
+	r := readResult(m, uint32(val))
+	tags := make(map[string][]string, r.rows)
+	for i := uint32(0); i < r.rows; i++ {
+		k, v := r.str(), r.str()
+		tags[k] = append(tags[k], v)
+	}
+	*t = tags
+}
+
+// wasmVisitTags walks a tags result in place, see [File.VisitTags].
+type wasmVisitTags struct {
+	fn  func(key, value []byte) bool
+	err error
+}
+
+func (v *wasmVisitTags) decode(m *module, val uint64) {
+	if val == 0 {
+		v.err = ErrInvalidFile
+		return
+	}
+	ptr := uint32(val)
+	size, ok := m.mod.memory().ReadUint32Le(ptr)
+	if !ok {
+		panic("memory error")
+	}
+	buf, ok := m.mod.memory().Read(ptr+4, size)
+	if !ok {
+		panic("memory error")
+	}
+
+	field := func() []byte {
+		n := leUint32(buf)
+		f := buf[4 : 4+n : 4+n]
+		buf = buf[4+n:]
+		return f
+	}
+	rows := leUint32(buf)
+	buf = buf[4:]
+	for i := uint32(0); i < rows; i++ {
+		if !v.fn(field(), field()) {
+			return
+		}
 	}
 }
 
@@ -1247,8 +3211,9 @@ type wasmFileProperties struct {
 	sampleRate           uint32
 	bitrate              uint32
 	bitsPerSample        uint32
-	imageDescs           []string
+	images               []ImageDesc
 	codec                string
+	estimated            uint32
 }
 
 func (f *wasmFileProperties) decode(m *module, val uint64) {
@@ -1257,21 +3222,104 @@ func (f *wasmFileProperties) decode(m *module, val uint64) {
 	}
 	ptr := uint32(val)
 
-	f.lengthInMilliseconds, _ = m.mod.Memory().ReadUint32Le(ptr)
-	f.channels, _ = m.mod.Memory().ReadUint32Le(ptr + 4)
-	f.sampleRate, _ = m.mod.Memory().ReadUint32Le(ptr + 8)
-	f.bitrate, _ = m.mod.Memory().ReadUint32Le(ptr + 12)
-	f.bitsPerSample, _ = m.mod.Memory().ReadUint32Le(ptr + 16)
+	f.lengthInMilliseconds, _ = m.mod.memory().ReadUint32Le(ptr)
+	f.channels, _ = m.mod.memory().ReadUint32Le(ptr + 4)
+	f.sampleRate, _ = m.mod.memory().ReadUint32Le(ptr + 8)
+	f.bitrate, _ = m.mod.memory().ReadUint32Le(ptr + 12)
+	f.bitsPerSample, _ = m.mod.memory().ReadUint32Le(ptr + 16)
 
-	imageMetadataPtr, _ := m.mod.Memory().ReadUint32Le(ptr + 20)
+	imageMetadataPtr, _ := m.mod.memory().ReadUint32Le(ptr + 20)
 	if imageMetadataPtr != 0 {
-		f.imageDescs = readStrings(m, imageMetadataPtr)
+		r := readResult(m, imageMetadataPtr)
+		for i := uint32(0); i < r.rows; i++ {
+			f.images = append(f.images, ImageDesc{
+				Type:        r.str(),
+				Description: r.str(),
+				MIMEType:    r.str(),
+				Size:        int(r.num()),
+			})
+		}
 	}
 
-	codecPtr, _ := m.mod.Memory().ReadUint32Le(ptr + 24)
+	codecPtr, _ := m.mod.memory().ReadUint32Le(ptr + 24)
 	if codecPtr != 0 {
 		f.codec = readString(m, codecPtr)
 	}
+
+	f.estimated, _ = m.mod.memory().ReadUint32Le(ptr + 28)
+}
+
+func (f *wasmFileProperties) properties() Properties {
+	return Properties{
+		Length:        time.Duration(f.lengthInMilliseconds) * time.Millisecond,
+		Channels:      uint(f.channels),
+		SampleRate:    uint(f.sampleRate),
+		Bitrate:       uint(f.bitrate),
+		BitsPerSample: uint(f.bitsPerSample),
+		Codec:         f.codec,
+		Images:        f.images,
+		Estimated:     f.estimated != 0,
+	}
+}
+
+type wasmStreamStats StreamStats
+
+func (s *wasmStreamStats) decode(m *module, val uint64) {
+	if val == 0 {
+		return
+	}
+	ptr := uint32(val)
+
+	s.Hits, _ = m.mod.memory().ReadUint64Le(ptr)
+	s.Misses, _ = m.mod.memory().ReadUint64Le(ptr + 8)
+	s.ReaderCalls, _ = m.mod.memory().ReadUint64Le(ptr + 16)
+	s.BytesRead, _ = m.mod.memory().ReadUint64Le(ptr + 24)
+	s.WriterCalls, _ = m.mod.memory().ReadUint64Le(ptr + 32)
+	s.BytesWritten, _ = m.mod.memory().ReadUint64Le(ptr + 40)
+}
+
+type wasmArenaStats struct {
+	peak     uint64
+	reserved uint64
+}
+
+func (s *wasmArenaStats) decode(m *module, val uint64) {
+	if val == 0 {
+		return
+	}
+	ptr := uint32(val)
+
+	s.peak, _ = m.mod.memory().ReadUint64Le(ptr)
+	s.reserved, _ = m.mod.memory().ReadUint64Le(ptr + 8)
+}
+
+type wasmReadAll struct {
+	tags       wasmTags
+	raw        wasmTags
+	properties wasmFileProperties
+	format     uint8
+}
+
+func (r *wasmReadAll) decode(m *module, val uint64) {
+	if val == 0 {
+		return
+	}
+	ptr := uint32(val)
+
+	tagsPtr, _ := m.mod.memory().ReadUint32Le(ptr)
+	r.tags.decode(m, uint64(tagsPtr))
+	rawPtr, _ := m.mod.memory().ReadUint32Le(ptr + 4)
+	r.raw.decode(m, uint64(rawPtr))
+	propertiesPtr, _ := m.mod.memory().ReadUint32Le(ptr + 8)
+	r.properties.decode(m, uint64(propertiesPtr))
+	r.format = m.readUint8(ptr + 12)
+}
+
+func (r *wasmReadAll) metadata() Metadata {
+	return Metadata{
+		AllTags:    AllTags{Tags: r.tags, Raw: r.raw, Format: FileFormat(r.format)},
+		Properties: r.properties.properties(),
+	}
 }
 
 type wasmOpenResult struct {
@@ -1285,19 +3333,81 @@ func (r *wasmOpenResult) decode(m *module, val uint64) {
 	}
 	ptr := uint32(val)
 
-	r.handle, _ = m.mod.Memory().ReadUint32Le(ptr)
-	format, _ := m.mod.Memory().ReadByte(ptr + 4)
-	r.format = format
+	r.handle, _ = m.mod.memory().ReadUint32Le(ptr)
+	r.format = m.readUint8(ptr + 4)
+}
+
+// readUint8 reads the byte at ptr, or 0 if it's out of range.
+func (m *module) readUint8(ptr uint32) uint8 {
+	b, ok := m.mod.memory().Read(ptr, 1)
+	if !ok {
+		return 0
+	}
+	return b[0]
 }
 
 func (m *module) call(name string, dest wasmResult, args ...wasmArg) error {
+	return m.callContext(context.Background(), name, dest, args...)
+}
+
+// callContext calls the export name, stopping it if ctx ends first. A call stopped while
+// the guest was running leaves the instance closed, so it's marked broken and replaced
+// rather than going back to the pool. A call whose stream reads were cut short by ctx
+// finished normally, so the instance is kept, but its results are dropped.
+func (m *module) callContext(ctx context.Context, name string, dest wasmResult, args ...wasmArg) error {
+	if m.broken {
+		return fmt.Errorf("call %q: %w", name, errBrokenModule)
+	}
+	if err := ctx.Err(); err != nil {
+		return fmt.Errorf("call %q: %w", name, err)
+	}
+
+	var exhausted bool
+	if m.limited {
+		ctx = context.WithValue(ctx, memoryExhaustedKey{}, &exhausted)
+	}
+
+	// Results of the previous call have all been decoded by now. The guest frees them itself
+	// when this call allocates its first argument or, failing that, when the call starts.
+	// An argument that can't be allocated leaves the arena half filled, so the instance is
+	// replaced like one whose call failed.
 	params := make([]uint64, 0, len(args))
 	for _, a := range args {
-		params = append(params, a.encode(m))
+		param, err := a.encode(ctx, m)
+		if err != nil {
+			m.broken = true
+			if exhausted {
+				return fmt.Errorf("call %q: %w", name, ErrMemoryLimit)
+			}
+			return fmt.Errorf("call %q: %w", name, contextErr(ctx, err))
+		}
+		params = append(params, param)
+	}
+
+	mt := getMetrics()
+	var start time.Time
+	if mt != nil {
+		start = time.Now()
+	}
+	results, err := m.mod.call(ctx, name, params...)
+	if mt != nil {
+		mt.Call(CallInfo{
+			Export:      name,
+			Format:      m.format,
+			Duration:    time.Since(start),
+			MemoryPages: m.mod.memory().Size() / 65536,
+			Err:         err,
+		})
+	}
+	if exhausted {
+		m.broken = true
+		return fmt.Errorf("call %q: %w", name, ErrMemoryLimit)
 	}
-
-	results, err := m.mod.ExportedFunction(name).Call(context.Background(), params...)
 	if err != nil {
+		m.broken = true
+		return fmt.Errorf("call %q: %w", name, contextErr(ctx, err))
+	}
+	if err := ctx.Err(); err != nil {
 		return fmt.Errorf("call %q: %w", name, err)
 	}
 	if len(results) == 0 {
@@ -1308,32 +3418,106 @@ func (m *module) call(name string, dest wasmResult, args ...wasmArg) error {
 	return nil
 }
 
+// memoryExhaustedKey holds, in the context of a call, the flag hostMemoryExhausted sets
+type memoryExhaustedKey struct{}
+
+// hostMemoryExhausted is called by the module when an allocation fails. It's only listened
+// for with a memory limit, since without one the failure is too rare to be worth a context.
+func hostMemoryExhausted(ctx context.Context) {
+	if exhausted, ok := ctx.Value(memoryExhaustedKey{}).(*bool); ok {
+		*exhausted = true
+	}
+}
+
+// errBrokenModule is returned for calls on an instance an earlier call failed on
+var errBrokenModule = errors.New("module instance is closed")
+
+// contextErr returns the error of ctx if it has ended, since the backend's own error for
+// a stopped call doesn't match context.Canceled or context.DeadlineExceeded
+func contextErr(ctx context.Context, err error) error {
+	if ctxErr := ctx.Err(); ctxErr != nil {
+		return ctxErr
+	}
+	return err
+}
+
+// release ends the lease on m. The guest drops any handles and allocations left over from
+// the lease, then the instance is kept for the next caller. If the pool is full, or the
+// instance is unusable or holds more memory than WithRecyclePages allows, it's closed instead.
+func (m *module) release() {
+	m.format = FormatUnknown
+	if m.fs != nil {
+		m.fs.allow()
+	}
+	if !m.broken && m.pool.readOnly {
+		_ = m.call("taglib_reset", nil)
+	}
+	if m.broken || m.oversized() || !m.pool.put(m) {
+		m.close()
+	}
+}
+
+// oversized reports whether the memory of m grew past the WithRecyclePages threshold
+func (m *module) oversized() bool {
+	pages := getConfig().recyclePages
+	return pages > 0 && instanceMemory && uint64(m.mod.memory().Size()) > uint64(pages)*65536
+}
+
 func (m *module) close() {
-	if err := m.mod.Close(context.Background()); err != nil {
+	if err := m.mod.close(); err != nil {
 		panic(err)
 	}
 }
 
-func readStrings(m *module, ptr uint32) []string {
-	strs := []string{} // non nil so call knows if it's just empty
-	for {
-		stringPtr, ok := m.mod.Memory().ReadUint32Le(ptr)
-		if !ok {
-			panic("memory error")
-		}
-		if stringPtr == 0 {
-			break
-		}
-		str := readString(m, stringPtr)
-		strs = append(strs, str)
-		ptr += 4
+// resultReader walks a result buffer built by the guest's ResultBuffer:
+//
+//	[u32 size][u32 rows] then for each field [u32 length][length bytes of UTF-8]
+//
+// The whole buffer is copied out of guest memory once, then fields are substrings of it.
+type resultReader struct {
+	buf  string
+	off  int
+	rows uint32
+}
+
+func readResult(m *module, ptr uint32) *resultReader {
+	size, ok := m.mod.memory().ReadUint32Le(ptr)
+	if !ok {
+		panic("memory error")
+	}
+	b, ok := m.mod.memory().Read(ptr+4, size)
+	if !ok {
+		panic("memory error")
 	}
-	return strs
+	r := &resultReader{buf: string(b)}
+	r.rows = r.uint32()
+	return r
+}
+
+func (r *resultReader) uint32() uint32 {
+	b := r.buf[r.off : r.off+4]
+	r.off += 4
+	return uint32(b[0]) | uint32(b[1])<<8 | uint32(b[2])<<16 | uint32(b[3])<<24
+}
+
+// num reads a field holding a single u32.
+func (r *resultReader) num() uint32 {
+	if n := r.uint32(); n != 4 {
+		panic("bad numeric field")
+	}
+	return r.uint32()
+}
+
+func (r *resultReader) str() string {
+	n := int(r.uint32())
+	s := r.buf[r.off : r.off+n]
+	r.off += n
+	return s
 }
 
 func readString(m *module, ptr uint32) string {
 	size := uint32(64)
-	buf, ok := m.mod.Memory().Read(ptr, size)
+	buf, ok := m.mod.memory().Read(ptr, size)
 	if !ok {
 		panic("memory error")
 	}
@@ -1342,7 +3526,7 @@ func readString(m *module, ptr uint32) string {
 	}
 
 	for {
-		next, ok := m.mod.Memory().Read(ptr+size, size)
+		next, ok := m.mod.memory().Read(ptr+size, size)
 		if !ok {
 			panic("memory error")
 		}
@@ -1355,27 +3539,28 @@ func readString(m *module, ptr uint32) string {
 }
 
 func readBytes(m *module, ptr uint32) []byte {
-	ret := []byte{} // non nil so call knows if it's just empty
+	// copy the data, "this returns a view of the underlying memory, not a copy" per api.Memory.Read docs
+	b := viewBytes(m, ptr)
+	ret := make([]byte, len(b)) // non nil so call knows if it's just empty
+	copy(ret, b)
+	return ret
+}
 
-	size, ok := m.mod.Memory().ReadUint32Le(ptr)
+func viewBytes(m *module, ptr uint32) []byte {
+	size, ok := m.mod.memory().ReadUint32Le(ptr)
 	if !ok {
 		panic("memory error")
 	}
 	if size == 0 {
-		return ret
+		return []byte{}
 	}
 
-	loc, _ := m.mod.Memory().ReadUint32Le(ptr + 4)
-	b, ok := m.mod.Memory().Read(loc, size)
+	loc, _ := m.mod.memory().ReadUint32Le(ptr + 4)
+	b, ok := m.mod.memory().Read(loc, size)
 	if !ok {
 		panic("memory error")
 	}
-
-	// copy the data, "this returns a view of the underlying memory, not a copy" per api.Memory.Read docs
-	ret = make([]byte, size)
-	copy(ret, b)
-
-	return ret
+	return b
 }
 
 // WASI uses POSIXy paths, even on Windows
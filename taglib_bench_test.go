@@ -1,9 +1,15 @@
 package taglib_test
 
 import (
+	"bytes"
+	"fmt"
+	"io"
 	"os"
 	"path/filepath"
+	"runtime"
+	"strings"
 	"testing"
+	"time"
 
 	"go.senan.xyz/taglib"
 )
@@ -15,6 +21,9 @@ var testFiles = []string{
 	"eg.ogg",
 	"eg.wav",
 	"eg.aiff",
+	"eg.opus",
+	"eg.wma",
+	"eg.mka",
 }
 
 func BenchmarkOpen(b *testing.B) {
@@ -29,6 +38,7 @@ func BenchmarkOpen(b *testing.B) {
 			}
 			_ = f.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				f, err := taglib.OpenReadOnly(path)
@@ -49,6 +59,7 @@ func BenchmarkOpen(b *testing.B) {
 			_ = f.Close()
 			_ = file.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				file, _ := os.Open(path)
@@ -63,6 +74,32 @@ func BenchmarkOpen(b *testing.B) {
 	}
 }
 
+func BenchmarkOpenTagsOnly(b *testing.B) {
+	for _, name := range testFiles {
+		path := filepath.Join("testdata", name)
+
+		b.Run(name, func(b *testing.B) {
+			// Warm up
+			f, err := taglib.OpenReadOnly(path, taglib.WithAudioProperties(false))
+			if err != nil {
+				b.Fatal(err)
+			}
+			_ = f.Close()
+
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				f, err := taglib.OpenReadOnly(path, taglib.WithAudioProperties(false))
+				if err != nil {
+					b.Fatal(err)
+				}
+				_ = f.Tags()
+				_ = f.Close()
+			}
+		})
+	}
+}
+
 func BenchmarkReadTags(b *testing.B) {
 	for _, name := range testFiles {
 		path := filepath.Join("testdata", name)
@@ -76,6 +113,7 @@ func BenchmarkReadTags(b *testing.B) {
 			_ = f.Tags()
 			_ = f.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				f, err := taglib.OpenReadOnly(path)
@@ -98,6 +136,7 @@ func BenchmarkReadTags(b *testing.B) {
 			_ = f.Close()
 			_ = file.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				file, _ := os.Open(path)
@@ -126,6 +165,7 @@ func BenchmarkReadProperties(b *testing.B) {
 			_ = f.Properties()
 			_ = f.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				f, err := taglib.OpenReadOnly(path)
@@ -148,6 +188,7 @@ func BenchmarkReadProperties(b *testing.B) {
 			_ = f.Close()
 			_ = file.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				file, _ := os.Open(path)
@@ -177,6 +218,7 @@ func BenchmarkReadAll(b *testing.B) {
 			_ = f.Properties()
 			_ = f.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				f, err := taglib.OpenReadOnly(path)
@@ -201,6 +243,7 @@ func BenchmarkReadAll(b *testing.B) {
 			_ = f.Close()
 			_ = file.Close()
 
+			b.ReportAllocs()
 			b.ResetTimer()
 			for i := 0; i < b.N; i++ {
 				file, _ := os.Open(path)
@@ -215,4 +258,335 @@ func BenchmarkReadAll(b *testing.B) {
 			}
 		})
 	}
-}
\ No newline at end of file
+}
+
+func BenchmarkScanner(b *testing.B) {
+	var paths []string
+	for _, name := range testFiles {
+		paths = append(paths, filepath.Join("testdata", name))
+	}
+	scanner := taglib.NewScanner()
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	jobs := make(chan taglib.ScanJob)
+	go func() {
+		defer close(jobs)
+		for i := 0; i < b.N; i++ {
+			jobs <- taglib.ScanJob{Path: paths[i%len(paths)]}
+		}
+	}()
+	for res := range scanner.Scan(jobs) {
+		if res.Err != nil {
+			b.Fatal(res.Err)
+		}
+	}
+}
+
+// BenchmarkCompile measures the start up cost of compiling the module, with an empty cache
+// as on a fresh container, and with one filled by Precompile.
+func BenchmarkCompile(b *testing.B) {
+	b.Run("Cold", func(b *testing.B) {
+		for i := 0; i < b.N; i++ {
+			if err := taglib.Precompile(b.TempDir()); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+
+	b.Run("Warm", func(b *testing.B) {
+		dir := b.TempDir()
+		if err := taglib.Precompile(dir); err != nil {
+			b.Fatal(err)
+		}
+
+		b.ResetTimer()
+		for i := 0; i < b.N; i++ {
+			if err := taglib.Precompile(dir); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
+
+type fixture struct {
+	name string
+	path string
+}
+
+// largeFixtures writes files much bigger than the ones in testdata, to cover what only
+// shows up in real libraries: multi-MB artwork, thousands of ID3v2 frames, and a
+// Matroska file with a large tags element.
+func largeFixtures(b *testing.B) []fixture {
+	b.Helper()
+
+	// Decoders stop at the JPEG end of image marker, so padding still gives a valid cover
+	cover := append(bytes.Clone(coverJPG), make([]byte, 8<<20)...)
+
+	manyTags := func(n, size int) map[string][]string {
+		tags := make(map[string][]string, n)
+		for i := 0; i < n; i++ {
+			tags[fmt.Sprintf("CUSTOM_%04d", i)] = []string{strings.Repeat("x", size)}
+		}
+		return tags
+	}
+
+	var fixtures []fixture
+	for _, eg := range []struct {
+		name string
+		data []byte
+	}{
+		{"cover.flac", egFLAC},
+		{"cover.mp3", egMP3},
+		{"cover.m4a", egM4a},
+	} {
+		path := tmpf(b, eg.data, eg.name)
+		nilErr(b, taglib.WriteImage(path, cover))
+		fixtures = append(fixtures, fixture{eg.name, path})
+	}
+
+	path := tmpf(b, egMP3, "frames.mp3")
+	nilErr(b, taglib.WriteTags(path, manyTags(1000, 16), taglib.Clear))
+	fixtures = append(fixtures, fixture{"frames.mp3", path})
+
+	path = tmpf(b, egMKA, "tags.mka")
+	nilErr(b, taglib.WriteTags(path, manyTags(1000, 1024), taglib.Clear))
+	fixtures = append(fixtures, fixture{"tags.mka", path})
+
+	return fixtures
+}
+
+// reportGuestMemory reports the size of the linear memory of the module instance behind f.
+// Wasm memory never shrinks, so it is the high-water mark of everything run on the instance.
+func reportGuestMemory(b *testing.B, f *taglib.File) {
+	b.ReportMetric(float64(f.MemoryStats().Size)/(1<<20), "guest-MiB")
+}
+
+func BenchmarkLarge(b *testing.B) {
+	for _, fx := range largeFixtures(b) {
+		b.Run("ReadAll/"+fx.name, func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := taglib.ReadAll(fx.path); err != nil {
+					b.Fatal(err)
+				}
+			}
+
+			b.StopTimer()
+			f, err := taglib.OpenReadOnly(fx.path)
+			if err != nil {
+				b.Fatal(err)
+			}
+			_ = f.ReadAll()
+			reportGuestMemory(b, f)
+			_ = f.Close()
+		})
+
+		b.Run("Image/"+fx.name, func(b *testing.B) {
+			f, err := taglib.OpenReadOnly(fx.path)
+			if err != nil {
+				b.Fatal(err)
+			}
+			defer f.Close()
+
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				if _, err := f.ImageTo(0, io.Discard); err != nil {
+					b.Fatal(err)
+				}
+			}
+
+			b.StopTimer()
+			reportGuestMemory(b, f)
+		})
+	}
+}
+
+func BenchmarkWriteTags(b *testing.B) {
+	tags := map[string][]string{
+		taglib.Title:  {"Benchmark"},
+		taglib.Artist: {"go-taglib"},
+	}
+	for _, name := range testFiles {
+		data, err := os.ReadFile(filepath.Join("testdata", name))
+		if err != nil {
+			b.Fatal(err)
+		}
+		path := tmpf(b, data, name)
+
+		b.Run(name, func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if err := taglib.WriteTags(path, tags, 0); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkWriteImage(b *testing.B) {
+	for _, name := range []string{"eg.mp3", "eg.flac", "eg.m4a"} {
+		data, err := os.ReadFile(filepath.Join("testdata", name))
+		if err != nil {
+			b.Fatal(err)
+		}
+		path := tmpf(b, data, name)
+
+		b.Run(name, func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if err := taglib.WriteImage(path, coverJPG); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkParallel(b *testing.B) {
+	var paths []string
+	var datas [][]byte
+	for _, name := range testFiles {
+		path := filepath.Join("testdata", name)
+		data, err := os.ReadFile(path)
+		if err != nil {
+			b.Fatal(err)
+		}
+		paths = append(paths, path)
+		datas = append(datas, data)
+	}
+
+	b.Run("File", func(b *testing.B) {
+		b.ReportAllocs()
+		b.RunParallel(func(pb *testing.PB) {
+			for i := 0; pb.Next(); i++ {
+				if _, err := taglib.ReadAll(paths[i%len(paths)]); err != nil {
+					b.Error(err)
+					return
+				}
+			}
+		})
+	})
+
+	b.Run("ReaderAt", func(b *testing.B) {
+		b.ReportAllocs()
+		b.RunParallel(func(pb *testing.PB) {
+			for i := 0; pb.Next(); i++ {
+				data := datas[i%len(datas)]
+				f, err := taglib.OpenReaderAt(bytes.NewReader(data), int64(len(data)))
+				if err != nil {
+					b.Error(err)
+					return
+				}
+				_ = f.ReadAll()
+				_ = f.Close()
+			}
+		})
+	})
+}
+
+// BenchmarkInstance compares calls that get a module instance from the pool with ones
+// that instantiate a new one, as happens when more calls are in flight than the pool holds.
+func BenchmarkInstance(b *testing.B) {
+	path := filepath.Join("testdata", "eg.flac")
+
+	b.Run("Warm", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if _, err := taglib.ReadTags(path); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+
+	b.Run("Cold", func(b *testing.B) {
+		taglib.Configure(taglib.WithPoolSize(0))
+		b.Cleanup(func() { taglib.Configure(taglib.WithPoolSize(runtime.GOMAXPROCS(0))) })
+
+		b.ReportAllocs()
+		b.ResetTimer()
+		for i := 0; i < b.N; i++ {
+			if _, err := taglib.ReadTags(path); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
+
+// latencyReaderAt delays every read, like a network filesystem or object store would.
+type latencyReaderAt struct {
+	r     io.ReaderAt
+	delay time.Duration
+}
+
+func (l latencyReaderAt) ReadAt(p []byte, off int64) (int, error) {
+	time.Sleep(l.delay)
+	return l.r.ReadAt(p, off)
+}
+
+func BenchmarkStreamLatency(b *testing.B) {
+	for _, name := range testFiles {
+		data, err := os.ReadFile(filepath.Join("testdata", name))
+		if err != nil {
+			b.Fatal(err)
+		}
+
+		for _, delay := range []time.Duration{0, 100 * time.Microsecond, time.Millisecond} {
+			b.Run(fmt.Sprintf("%s/%s", name, delay), func(b *testing.B) {
+				r := latencyReaderAt{bytes.NewReader(data), delay}
+
+				b.ReportAllocs()
+				var reads uint64
+				for i := 0; i < b.N; i++ {
+					f, err := taglib.OpenReaderAt(r, int64(len(data)))
+					if err != nil {
+						b.Fatal(err)
+					}
+					_ = f.ReadAll()
+					reads += f.StreamStats().ReaderCalls
+					_ = f.Close()
+				}
+				b.ReportMetric(float64(reads)/float64(b.N), "reads/op")
+			})
+		}
+	}
+}
+
+// BenchmarkVisitTags compares building the tags map with visiting the tags in place.
+func BenchmarkVisitTags(b *testing.B) {
+	for _, name := range testFiles {
+		path := filepath.Join("testdata", name)
+		f, err := taglib.OpenReadOnly(path)
+		if err != nil {
+			b.Fatal(err)
+		}
+
+		b.Run("Tags/"+name, func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				_ = f.Tags()
+			}
+		})
+
+		b.Run("Visit/"+name, func(b *testing.B) {
+			var title string
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				err := f.VisitTags(func(key, value []byte) bool {
+					if string(key) == taglib.Title {
+						title = string(value)
+					}
+					return true
+				})
+				if err != nil {
+					b.Fatal(err)
+				}
+			}
+			_ = title
+		})
+
+		_ = f.Close()
+	}
+}
@@ -0,0 +1,320 @@
+//go:build taglib_native
+
+// Native build of taglib.cpp, linked into the Go binary through cgo with the taglib_native
+// build tag. See native.go.
+//
+// The host talks to the exports as it does to the Wasm module: arguments and results are
+// passed as 32 bit offsets into one address space. Here that's a region reserved up front,
+// which the arena allocates from, so results keep the layout they have in Wasm memory.
+// Every other allocation, TagLib's included, uses the normal heap.
+//
+// Instances share the process, so the globals of taglib.cpp are kept per instance. The host
+// passes the instance to each call, and the call points t_instance at it while it runs.
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define TAGLIB_NATIVE 1
+#define TAGLIB_EXPORT(name)
+#define TAGLIB_IMPORT(name)
+
+// ============================================================================
+// Boundary region
+// ============================================================================
+
+// Offsets are 32 bits, so that's as much as can be reserved. Pages are only backed once
+// they're touched.
+static constexpr size_t REGION_SIZE = size_t(1) << 32;
+static constexpr size_t REGION_ALIGN = 16;
+
+class Region {
+public:
+  Region() {
+    void *base = mmap(nullptr, REGION_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    m_base = base == MAP_FAILED ? nullptr : static_cast<char *>(base);
+  }
+
+  char *base() const { return m_base; }
+
+  // Returns size bytes from the region, or null if it's full. Offset 0 is never handed out,
+  // so a null pointer and offset 0 mean the same thing.
+  void *alloc(size_t size) {
+    if (!m_base)
+      return nullptr;
+    size = (size + REGION_ALIGN - 1) & ~(REGION_ALIGN - 1);
+
+    std::lock_guard<std::mutex> lock(m_mu);
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+      if (it->second < size)
+        continue;
+      const size_t offset = it->first;
+      const size_t rest = it->second - size;
+      m_free.erase(it);
+      if (rest > 0)
+        m_free.emplace(offset + size, rest);
+      m_used.emplace(offset, size);
+      return m_base + offset;
+    }
+
+    if (m_top + size > REGION_SIZE)
+      return nullptr;
+    const size_t offset = m_top;
+    m_top += size;
+    m_peak = std::max(m_peak, m_top);
+    m_used.emplace(offset, size);
+    return m_base + offset;
+  }
+
+  // Gives memory from alloc back, merging it with free neighbours
+  void free(void *p) {
+    if (!p)
+      return;
+    std::lock_guard<std::mutex> lock(m_mu);
+    auto used = m_used.find(static_cast<char *>(p) - m_base);
+    if (used == m_used.end())
+      return;
+    size_t offset = used->first;
+    size_t size = used->second;
+    m_used.erase(used);
+
+    auto next = m_free.lower_bound(offset);
+    if (next != m_free.end() && next->first == offset + size) {
+      size += next->second;
+      next = m_free.erase(next);
+    }
+    if (next != m_free.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == offset) {
+        offset = prev->first;
+        size += prev->second;
+        m_free.erase(prev);
+      }
+    }
+    if (offset + size == m_top)
+      m_top = offset;
+    else
+      m_free.emplace(offset, size);
+  }
+
+  // The most of the region that has been in use at once, like the size of a Wasm memory
+  uint32_t size() {
+    std::lock_guard<std::mutex> lock(m_mu);
+    return static_cast<uint32_t>(std::min(m_peak, REGION_SIZE - 1));
+  }
+
+private:
+  char *m_base = nullptr;
+  std::mutex m_mu;
+  size_t m_top = REGION_ALIGN;
+  size_t m_peak = REGION_ALIGN;
+  std::map<size_t, size_t> m_free; // offset -> size
+  std::map<size_t, size_t> m_used; // offset -> size
+};
+
+static Region g_region;
+
+static void *boundary_alloc(size_t size) { return g_region.alloc(size); }
+static void boundary_free(void *p) { g_region.free(p); }
+
+static uint32_t native_offset(const void *p) {
+  return p ? static_cast<uint32_t>(static_cast<const char *>(p) - g_region.base()) : 0;
+}
+
+static void *native_pointer(uint64_t offset) {
+  return offset ? g_region.base() + static_cast<uint32_t>(offset) : nullptr;
+}
+
+// A pointer stored in memory the host reads or writes, kept as a 32 bit offset into the
+// region so it has the size it has in Wasm.
+template <typename T> class guest_ptr {
+public:
+  guest_ptr(T *p = nullptr) : m_offset(native_offset(p)) {}
+  operator T *() const { return static_cast<T *>(native_pointer(m_offset)); }
+  T *operator->() const { return *this; }
+
+private:
+  uint32_t m_offset;
+};
+
+// ============================================================================
+// Instances
+// ============================================================================
+
+struct taglib_native_instance {
+  std::vector<std::pair<const void *, std::shared_ptr<void>>> state;
+  bool readOnly = false;
+};
+
+static thread_local taglib_native_instance *t_instance;
+
+// Native code has no mount to stop it writing, so a read-only instance refuses to save files
+// by path itself. Streams are still written, as the host decides what they allow.
+static bool native_read_only() { return t_instance->readOnly; }
+
+// Returns the calling instance's copy of a taglib.cpp global of type T
+template <typename T> static T &native_state() {
+  static const char key = 0;
+  for (auto &[k, v] : t_instance->state) {
+    if (k == &key)
+      return *static_cast<T *>(v.get());
+  }
+  auto state = std::make_shared<T>();
+  t_instance->state.emplace_back(&key, state);
+  return *state;
+}
+
+#include "taglib.cpp"
+
+// ============================================================================
+// Calls from the host
+// ============================================================================
+
+// Arguments arrive as the u64 values wazero would pass, pointers as region offsets
+template <typename T> static T from_param(uint64_t v) {
+  if constexpr (std::is_pointer_v<T>)
+    return static_cast<T>(native_pointer(v));
+  else
+    return static_cast<T>(v);
+}
+
+// Results go back as the u64 values wazero would return, with 32 bit values zero extended
+template <typename T> static uint64_t to_result(T v) {
+  if constexpr (std::is_pointer_v<T>)
+    return native_offset(v);
+  else if constexpr (std::is_integral_v<T> && sizeof(T) < sizeof(uint64_t))
+    return static_cast<std::make_unsigned_t<T>>(v);
+  else
+    return static_cast<uint64_t>(v);
+}
+
+template <typename F> struct export_traits;
+
+template <typename R, typename... Args> struct export_traits<R (*)(Args...)> {
+  static constexpr size_t arity = sizeof...(Args);
+  static constexpr bool has_result = !std::is_void_v<R>;
+
+  template <auto Fn, size_t... I>
+  static uint64_t call(const uint64_t *params, std::index_sequence<I...>) {
+    if constexpr (has_result) {
+      return to_result(Fn(from_param<Args>(params[I])...));
+    } else {
+      Fn(from_param<Args>(params[I])...);
+      return 0;
+    }
+  }
+};
+
+template <auto Fn> static uint64_t call_export(const uint64_t *params) {
+  using traits = export_traits<decltype(Fn)>;
+  return traits::template call<Fn>(params, std::make_index_sequence<traits::arity>());
+}
+
+struct NativeExport {
+  const char *name;
+  size_t arity;
+  bool has_result;
+  uint64_t (*call)(const uint64_t *params);
+};
+
+#define NATIVE_EXPORT(name, fn)                                                        \
+  NativeExport {                                                                       \
+    name, export_traits<decltype(&fn)>::arity, export_traits<decltype(&fn)>::has_result, \
+        call_export<&fn>                                                               \
+  }
+
+// Must list every TAGLIB_EXPORT in taglib.cpp
+static const NativeExport g_exports[] = {
+    NATIVE_EXPORT("taglib_version", taglib_version),
+    NATIVE_EXPORT("malloc", exported_malloc),
+    NATIVE_EXPORT("taglib_reset", taglib_reset),
+    NATIVE_EXPORT("taglib_arena_stats", taglib_arena_stats),
+    NATIVE_EXPORT("taglib_file_open", taglib_file_open),
+    NATIVE_EXPORT("taglib_file_close", taglib_file_close),
+    NATIVE_EXPORT("taglib_stream_open", taglib_stream_open),
+    NATIVE_EXPORT("taglib_stream_open_reader_at", taglib_stream_open_reader_at),
+    NATIVE_EXPORT("taglib_handle_stream_stats", taglib_handle_stream_stats),
+    NATIVE_EXPORT("taglib_handle_tags", taglib_handle_tags),
+    NATIVE_EXPORT("taglib_handle_tags_keys", taglib_handle_tags_keys),
+    NATIVE_EXPORT("taglib_handle_raw_tags", taglib_handle_raw_tags),
+    NATIVE_EXPORT("taglib_handle_properties", taglib_handle_properties),
+    NATIVE_EXPORT("taglib_handle_read_all", taglib_handle_read_all),
+    NATIVE_EXPORT("taglib_handle_image", taglib_handle_image),
+    NATIVE_EXPORT("taglib_handle_image_size", taglib_handle_image_size),
+    NATIVE_EXPORT("taglib_handle_write_tags", taglib_handle_write_tags),
+    NATIVE_EXPORT("taglib_handle_write_image", taglib_handle_write_image),
+    NATIVE_EXPORT("taglib_handle_tag_fingerprint", taglib_handle_tag_fingerprint),
+    NATIVE_EXPORT("taglib_handle_apply", taglib_handle_apply),
+    NATIVE_EXPORT("taglib_file_tags", taglib_file_tags),
+    NATIVE_EXPORT("taglib_file_tags_keys", taglib_file_tags_keys),
+    NATIVE_EXPORT("taglib_file_read_all", taglib_file_read_all),
+    NATIVE_EXPORT("taglib_file_tags_batch", taglib_file_tags_batch),
+    NATIVE_EXPORT("taglib_file_read_all_batch", taglib_file_read_all_batch),
+    NATIVE_EXPORT("taglib_file_write_tags", taglib_file_write_tags),
+    NATIVE_EXPORT("taglib_file_read_properties", taglib_file_read_properties),
+    NATIVE_EXPORT("taglib_file_read_image", taglib_file_read_image),
+    NATIVE_EXPORT("taglib_file_write_image", taglib_file_write_image),
+    NATIVE_EXPORT("taglib_file_id3v2_frames", taglib_file_id3v2_frames),
+    NATIVE_EXPORT("taglib_file_id3v1_tags", taglib_file_id3v1_tags),
+    NATIVE_EXPORT("taglib_file_mp4_atoms", taglib_file_mp4_atoms),
+    NATIVE_EXPORT("taglib_file_asf_attributes", taglib_file_asf_attributes),
+    NATIVE_EXPORT("taglib_file_tag_fingerprint", taglib_file_tag_fingerprint),
+    NATIVE_EXPORT("taglib_file_write_id3v2_frames", taglib_file_write_id3v2_frames),
+};
+
+extern "C" {
+
+char *taglib_native_region_base(void) { return g_region.base(); }
+
+uint32_t taglib_native_region_size(void) { return g_region.size(); }
+
+size_t taglib_native_export_count(void) { return std::size(g_exports); }
+
+const char *taglib_native_export_name(size_t index) { return g_exports[index].name; }
+
+taglib_native_instance *taglib_native_new(int readOnly) {
+  auto *instance = new taglib_native_instance();
+  instance->readOnly = readOnly != 0;
+  return instance;
+}
+
+void taglib_native_free(taglib_native_instance *instance) {
+  taglib_native_instance *prev = t_instance;
+  t_instance = instance;
+  instance->state.clear();
+  t_instance = prev;
+  delete instance;
+}
+
+// Calls export index with count params on instance. Returns 1 and sets result if the export
+// returns a value, 0 if it doesn't, or -1 if the call was invalid or failed.
+int taglib_native_call(taglib_native_instance *instance, size_t index, const uint64_t *params,
+                       size_t count, uint64_t *result) {
+  if (index >= std::size(g_exports) || g_exports[index].arity != count)
+    return -1;
+  const NativeExport &e = g_exports[index];
+
+  taglib_native_instance *prev = t_instance;
+  t_instance = instance;
+  int status;
+  try {
+    *result = e.call(params);
+    status = e.has_result ? 1 : 0;
+  } catch (...) {
+    status = -1;
+  }
+  t_instance = prev;
+  return status;
+}
+
+}
\ No newline at end of file
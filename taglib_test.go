@@ -2,10 +2,13 @@ package taglib_test
 
 import (
 	"bytes"
+	"context"
 	_ "embed"
+	"encoding/binary"
 	"errors"
 	"fmt"
 	"image"
+	"io"
 	"maps"
 	"os"
 	"path/filepath"
@@ -263,6 +266,358 @@ func TestOpenStream(t *testing.T) {
 	}
 }
 
+func TestStreamStats(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			data, err := os.ReadFile(path)
+			nilErr(t, err)
+
+			r := &countingReader{ReadSeeker: bytes.NewReader(data)}
+			f, err := taglib.OpenStream(r, taglib.WithFilename(path))
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+			_ = f.Properties()
+
+			stats := f.StreamStats()
+			eq(t, stats.ReaderCalls <= r.calls, true)
+			eq(t, stats.BytesRead, r.bytes)
+			if stats.Misses == 0 || stats.Hits == 0 {
+				t.Fatalf("expected both hits and misses, got %+v", stats)
+			}
+		})
+	}
+
+	f, err := taglib.OpenReadOnly(tmpf(t, egFLAC, "eg.flac"))
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+	eq(t, f.StreamStats(), taglib.StreamStats{})
+}
+
+type countingReader struct {
+	io.ReadSeeker
+	calls, bytes uint64
+}
+
+func (r *countingReader) Read(p []byte) (int, error) {
+	n, err := r.ReadSeeker.Read(p)
+	r.calls++
+	r.bytes += uint64(n)
+	return n, err
+}
+
+func TestReadBudget(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			data, err := os.ReadFile(path)
+			nilErr(t, err)
+			r := bytes.NewReader(data)
+
+			open := func(opts ...taglib.OpenOption) (*taglib.File, error) {
+				opts = append(opts, taglib.WithFilename(path), taglib.WithReadStyle(taglib.ReadStyleFast))
+				return taglib.OpenReaderAt(r, int64(len(data)), opts...)
+			}
+
+			f, err := open()
+			nilErr(t, err)
+			tags, props, stats := f.Tags(), f.Properties(), f.StreamStats()
+			_ = f.Close()
+			eq(t, props.Estimated, false)
+
+			// A budget of exactly what was read isn't run out
+			f, err = open(taglib.WithReadBudget(int64(stats.BytesRead), int(stats.ReaderCalls)))
+			nilErr(t, err)
+			tagEq(t, f.Tags(), tags)
+			eq(t, f.Properties().Length, props.Length)
+			eq(t, f.Properties().Estimated, false)
+			_ = f.Close()
+
+			if stats.ReaderCalls < 2 {
+				return
+			}
+
+			// One read less either fails to open or leaves the properties estimated
+			f, err = open(taglib.WithReadBudget(0, int(stats.ReaderCalls)-1))
+			if err != nil {
+				return
+			}
+			defer func() { _ = f.Close() }()
+			eq(t, f.Properties().Estimated, true)
+			eq(t, f.StreamStats().ReaderCalls < stats.ReaderCalls, true)
+		})
+	}
+}
+
+func TestReadOnlySave(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egFLAC, "eg.flac")
+	before, err := os.ReadFile(path)
+	nilErr(t, err)
+
+	f, err := taglib.OpenReadOnly(path)
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+	err = f.WriteTags(map[string][]string{taglib.Title: {"Read only"}}, 0)
+	eq(t, errors.Is(err, taglib.ErrSavingFile), true)
+
+	after, err := os.ReadFile(path)
+	nilErr(t, err)
+	eq(t, bytes.Equal(after, before), true)
+}
+
+func TestContext(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egFLAC, "eg.flac")
+	data, err := os.ReadFile(path)
+	nilErr(t, err)
+	tags, err := taglib.ReadTags(path)
+	nilErr(t, err)
+
+	cancelled, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	_, err = taglib.OpenContext(cancelled, path)
+	eq(t, errors.Is(err, context.Canceled), true)
+	_, err = taglib.ReadTagsContext(cancelled, path)
+	eq(t, errors.Is(err, context.Canceled), true)
+	for _, res := range taglib.ReadAllBatchContext(cancelled, []string{path, path}) {
+		eq(t, errors.Is(res.Err, context.Canceled), true)
+	}
+
+	// Cancelled while the module is reading the stream
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	r := cancelReaderAt{bytes.NewReader(data), cancel}
+	_, err = taglib.OpenReaderAtContext(ctx, r, int64(len(data)), taglib.WithFilename(path))
+	eq(t, errors.Is(err, context.Canceled), true)
+
+	// Instances behind failed calls aren't reused
+	got, err := taglib.ReadTags(path)
+	nilErr(t, err)
+	tagEq(t, got, tags)
+
+	f, err := taglib.Open(path)
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+
+	_, err = f.TagsContext(cancelled)
+	eq(t, errors.Is(err, context.Canceled), true)
+	err = f.WriteTagsContext(cancelled, map[string][]string{taglib.Title: {"Cancelled"}}, 0)
+	eq(t, errors.Is(err, context.Canceled), true)
+	_, err = f.TagsForContext(cancelled, taglib.Title)
+	eq(t, errors.Is(err, context.Canceled), true)
+	err = f.VisitTagsContext(cancelled, func(key, value []byte) bool {
+		t.Error("visited after cancel")
+		return false
+	})
+	eq(t, errors.Is(err, context.Canceled), true)
+	err = f.WriteImageContext(cancelled, nil, 0, "", "", "")
+	eq(t, errors.Is(err, context.Canceled), true)
+	_, err = f.Edit().SetTags(map[string][]string{taglib.Title: {"Cancelled"}}, 0).ApplyContext(cancelled)
+	eq(t, errors.Is(err, context.Canceled), true)
+
+	got, err = f.TagsContext(context.Background())
+	nilErr(t, err)
+	tagEq(t, got, tags)
+
+	rw, err := os.OpenFile(path, os.O_RDWR, 0)
+	nilErr(t, err)
+	defer func() { _ = rw.Close() }()
+	_, err = taglib.OpenReadWriteStreamContext(cancelled, rw, taglib.WithFilename(path))
+	eq(t, errors.Is(err, context.Canceled), true)
+}
+
+// cancelReaderAt cancels its context on the first read
+type cancelReaderAt struct {
+	r      io.ReaderAt
+	cancel context.CancelFunc
+}
+
+func (c cancelReaderAt) ReadAt(p []byte, off int64) (int, error) {
+	c.cancel()
+	return c.r.ReadAt(p, off)
+}
+
+func TestOpenReaderAt(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			data, err := os.ReadFile(path)
+			nilErr(t, err)
+
+			fileTags, err := taglib.ReadTags(path)
+			nilErr(t, err)
+			fileProperties, err := taglib.ReadProperties(path)
+			nilErr(t, err)
+
+			// One reader shared by concurrent opens
+			r := bytes.NewReader(data)
+			files := make([]*taglib.File, 4)
+			errs := make([]error, len(files))
+			var wg sync.WaitGroup
+			for i := range files {
+				wg.Add(1)
+				go func() {
+					defer wg.Done()
+					files[i], errs[i] = taglib.OpenReaderAt(r, int64(len(data)), taglib.WithFilename(path))
+				}()
+			}
+			wg.Wait()
+
+			for i, f := range files {
+				nilErr(t, errs[i])
+				tagEq(t, f.Tags(), fileTags)
+				eq(t, f.Properties().Length, fileProperties.Length)
+				_ = f.Close()
+			}
+		})
+	}
+
+	_, err := taglib.OpenReaderAt(bytes.NewReader([]byte("not a file")), 10)
+	eq(t, err, taglib.ErrInvalidFile)
+}
+
+func TestOpenReadWriteStream(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			fileProperties, err := taglib.ReadProperties(path)
+			nilErr(t, err)
+
+			write := func(tags map[string][]string, opts taglib.WriteOption) {
+				rw, err := os.OpenFile(path, os.O_RDWR, 0)
+				nilErr(t, err)
+				defer func() { _ = rw.Close() }()
+
+				f, err := taglib.OpenReadWriteStream(rw, taglib.WithFilename(path))
+				nilErr(t, err)
+				defer func() { _ = f.Close() }()
+
+				nilErr(t, f.WriteTags(tags, opts))
+			}
+
+			// Growing the tags moves the audio forward, shrinking them moves it back
+			grown := map[string][]string{"ARTIST": {"Stream Artist"}, "COMMENT": {strings.Repeat("x", 64*1024)}}
+			write(grown, 0)
+			tags, err := taglib.ReadTags(path)
+			nilErr(t, err)
+			eq(t, tags["ARTIST"][0], "Stream Artist")
+			eq(t, tags["COMMENT"][0], grown["COMMENT"][0])
+
+			write(map[string][]string{"ARTIST": {"Short"}}, taglib.Clear)
+			tags, err = taglib.ReadTags(path)
+			nilErr(t, err)
+			eq(t, tags["ARTIST"][0], "Short")
+			_, ok := tags["COMMENT"]
+			eq(t, ok, false)
+
+			properties, err := taglib.ReadProperties(path)
+			nilErr(t, err)
+			eq(t, properties.Length, fileProperties.Length)
+		})
+	}
+
+	f, err := taglib.OpenStream(bytes.NewReader(egFLAC))
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+	eq(t, f.WriteTags(map[string][]string{"ARTIST": {"Read Only"}}, 0), taglib.ErrSavingFile)
+}
+
+// memFile is an in-memory io.ReaderAt and io.WriterAt that can be truncated
+type memFile struct{ data []byte }
+
+func (m *memFile) ReadAt(p []byte, off int64) (int, error) {
+	if off >= int64(len(m.data)) {
+		return 0, io.EOF
+	}
+	n := copy(p, m.data[off:])
+	if n < len(p) {
+		return n, io.EOF
+	}
+	return n, nil
+}
+
+func (m *memFile) WriteAt(p []byte, off int64) (int, error) {
+	if end := off + int64(len(p)); end > int64(len(m.data)) {
+		m.data = append(m.data, make([]byte, end-int64(len(m.data)))...)
+	}
+	return copy(m.data[off:], p), nil
+}
+
+func (m *memFile) Truncate(size int64) error {
+	m.data = m.data[:size]
+	return nil
+}
+
+func TestOpenReaderAtWithWriterAt(t *testing.T) {
+	t.Parallel()
+
+	m := &memFile{data: bytes.Clone(egFLAC)}
+	f, err := taglib.OpenReaderAt(m, int64(len(m.data)), taglib.WithWriterAt(m, m.Truncate))
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+
+	_, err = f.Edit().SetTags(map[string][]string{"ARTIST": {"WriterAt"}}, 0).ReservePadding(4096).Apply()
+	nilErr(t, err)
+
+	// With room in the padding, a small change only writes the tag region
+	before := f.StreamStats()
+	report, err := f.Edit().SetTags(map[string][]string{"ALBUM": {"In Place"}}, 0).Apply()
+	nilErr(t, err)
+	eq(t, report.InPlace, true)
+	written := f.StreamStats().BytesWritten - before.BytesWritten
+	eq(t, written > 0 && written < 64*1024, true)
+
+	r, err := taglib.OpenReaderAt(bytes.NewReader(m.data), int64(len(m.data)))
+	nilErr(t, err)
+	defer func() { _ = r.Close() }()
+	eq(t, r.Tags()["ARTIST"][0], "WriterAt")
+	eq(t, r.Tags()["ALBUM"][0], "In Place")
+}
+
+func TestOpenWithoutAudioProperties(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			fileTags, err := taglib.ReadTags(path)
+			nilErr(t, err)
+			fileProperties, err := taglib.ReadProperties(path)
+			nilErr(t, err)
+
+			f, err := taglib.Open(path, taglib.WithAudioProperties(false))
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+			tagEq(t, f.Tags(), fileTags)
+
+			// Audio properties are read when first asked for
+			eq(t, f.Properties().Length, fileProperties.Length)
+			eq(t, f.Properties().SampleRate, fileProperties.SampleRate)
+			tagEq(t, f.Tags(), fileTags)
+
+			data, err := os.ReadFile(path)
+			nilErr(t, err)
+			s, err := taglib.OpenStream(bytes.NewReader(data), taglib.WithFilename(path), taglib.WithAudioProperties(false))
+			nilErr(t, err)
+			defer func() { _ = s.Close() }()
+			tagEq(t, s.Tags(), fileTags)
+			eq(t, s.Properties().Length, fileProperties.Length)
+		})
+	}
+}
+
 func TestOpenStreamWithFilename(t *testing.T) {
 	t.Parallel()
 
@@ -367,6 +722,166 @@ func TestConcurrent(t *testing.T) {
 	nilErr(t, err)
 }
 
+func TestPooledModuleReuse(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for i, path := range paths {
+		err := taglib.WriteTags(path, map[string][]string{"TITLE": {fmt.Sprintf("track %d", i)}}, taglib.Clear)
+		nilErr(t, err)
+	}
+
+	// Read each file many times over, so pooled instances are reused across
+	// files and must not carry any state over between leases
+	for range 5 {
+		for i, path := range paths {
+			f, err := taglib.OpenReadOnly(path)
+			nilErr(t, err)
+			eq(t, f.Tags()["TITLE"][0], fmt.Sprintf("track %d", i))
+			nilErr(t, f.Close())
+
+			tags, err := taglib.ReadTags(path)
+			nilErr(t, err)
+			eq(t, tags["TITLE"][0], fmt.Sprintf("track %d", i))
+		}
+	}
+}
+
+func TestPoolSizeZero(t *testing.T) {
+	path := tmpf(t, egFLAC, "eg.flac")
+
+	taglib.Configure(taglib.WithPoolSize(0))
+	t.Cleanup(func() { taglib.Configure(taglib.WithPoolSize(runtime.GOMAXPROCS(0))) })
+
+	for range 3 {
+		_, err := taglib.ReadTags(path)
+		nilErr(t, err)
+	}
+}
+
+type recordingMetrics struct {
+	mu           sync.Mutex
+	instantiates int
+	calls        []taglib.CallInfo
+	io           []taglib.HostIOInfo
+}
+
+func (r *recordingMetrics) Instantiate(time.Duration, error) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.instantiates++
+}
+
+func (r *recordingMetrics) Call(info taglib.CallInfo) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.calls = append(r.calls, info)
+}
+
+func (r *recordingMetrics) HostIO(info taglib.HostIOInfo) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.io = append(r.io, info)
+}
+
+func TestMetrics(t *testing.T) {
+	rec := &recordingMetrics{}
+	taglib.Configure(taglib.WithMetrics(rec), taglib.WithPoolSize(0))
+	t.Cleanup(func() { taglib.Configure(taglib.WithMetrics(nil), taglib.WithPoolSize(runtime.GOMAXPROCS(0))) })
+
+	f, err := taglib.OpenReaderAt(bytes.NewReader(egFLAC), int64(len(egFLAC)))
+	nilErr(t, err)
+	_ = f.Tags()
+	nilErr(t, f.Close())
+
+	rec.mu.Lock()
+	defer rec.mu.Unlock()
+
+	eq(t, rec.instantiates > 0, true)
+
+	var tagsCall *taglib.CallInfo
+	for i := range rec.calls {
+		if rec.calls[i].Export == "taglib_handle_tags" {
+			tagsCall = &rec.calls[i]
+		}
+	}
+	eq(t, tagsCall != nil, true)
+	eq(t, tagsCall.Format, taglib.FormatFLAC)
+	eq(t, tagsCall.MemoryPages > 0, true)
+	nilErr(t, tagsCall.Err)
+
+	var read int64
+	for _, info := range rec.io {
+		eq(t, info.Op, taglib.HostReadAt)
+		read += info.Bytes
+	}
+	eq(t, read > 0, true)
+}
+
+func TestRecyclePages(t *testing.T) {
+	rec := &recordingMetrics{}
+	taglib.Configure(taglib.WithPoolSize(0)) // drop the instances pooled so far
+	taglib.Configure(taglib.WithPoolSize(runtime.GOMAXPROCS(0)), taglib.WithMetrics(rec), taglib.WithRecyclePages(1))
+	t.Cleanup(func() { taglib.Configure(taglib.WithMetrics(nil), taglib.WithRecyclePages(0)) })
+
+	// Every instance has more than a page, so none are pooled again
+	path := tmpf(t, egFLAC, "eg.flac")
+	for range 2 {
+		_, err := taglib.ReadTags(path)
+		nilErr(t, err)
+	}
+
+	rec.mu.Lock()
+	defer rec.mu.Unlock()
+	eq(t, rec.instantiates, 2)
+}
+
+func TestReadBudgetFormatDetection(t *testing.T) {
+	rec := &recordingMetrics{}
+	taglib.Configure(taglib.WithMetrics(rec))
+	t.Cleanup(func() { taglib.Configure(taglib.WithMetrics(nil)) })
+
+	reads := func() int {
+		rec.mu.Lock()
+		defer rec.mu.Unlock()
+		n := len(rec.io)
+		rec.io = nil
+		return n
+	}
+
+	// Without a filename the format is sniffed first, and those reads are reported too
+	f, err := taglib.OpenReaderAt(bytes.NewReader(egFLAC), int64(len(egFLAC)))
+	nilErr(t, err)
+	tags, calls := f.Tags(), f.StreamStats().ReaderCalls
+	nilErr(t, f.Close())
+	total := reads()
+	eq(t, total > int(calls), true)
+
+	// and count against the budget
+	f, err = taglib.OpenReaderAt(bytes.NewReader(egFLAC), int64(len(egFLAC)), taglib.WithReadBudget(0, total))
+	nilErr(t, err)
+	tagEq(t, f.Tags(), tags)
+	nilErr(t, f.Close())
+	eq(t, reads() <= total, true)
+}
+
+func TestWritableNotPooled(t *testing.T) {
+	rec := &recordingMetrics{}
+	taglib.Configure(taglib.WithMetrics(rec))
+	t.Cleanup(func() { taglib.Configure(taglib.WithMetrics(nil)) })
+
+	// Each write gets an instance that mounts only its directory
+	path := tmpf(t, egFLAC, "eg.flac")
+	for _, title := range []string{"a", "b"} {
+		err := taglib.WriteTags(path, map[string][]string{"TITLE": {title}}, 0)
+		nilErr(t, err)
+	}
+
+	rec.mu.Lock()
+	defer rec.mu.Unlock()
+	eq(t, rec.instantiates, 2)
+}
+
 func TestProperties(t *testing.T) {
 	t.Parallel()
 
@@ -504,16 +1019,40 @@ func TestWriteImage(t *testing.T) {
 	}
 }
 
-func TestClearImage(t *testing.T) {
-	path := tmpf(t, egFLAC, "eg.flac")
-
-	properties, err := taglib.ReadProperties(path)
-	nilErr(t, err)
-	eq(t, len(properties.Images) == 2, true) // have two imaages
-	eq(t, properties.Images[0].Description, "The first image")
+func TestImageDescSize(t *testing.T) {
+	t.Parallel()
 
-	img, err := taglib.ReadImage(path)
-	nilErr(t, err)
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			err := taglib.WriteImageOptions(path, coverJPG, 0, "Front Cover", "cover", "image/jpeg")
+			nilErr(t, err)
+
+			properties, err := taglib.ReadProperties(path)
+			nilErr(t, err)
+			if len(properties.Images) == 0 {
+				t.Skip("format doesn't store images")
+			}
+			eq(t, properties.Images[0].MIMEType, "image/jpeg")
+			eq(t, properties.Images[0].Size, len(coverJPG))
+
+			imgBytes, err := taglib.ReadImageOptions(path, 0)
+			nilErr(t, err)
+			eq(t, len(imgBytes), properties.Images[0].Size)
+		})
+	}
+}
+
+func TestClearImage(t *testing.T) {
+	path := tmpf(t, egFLAC, "eg.flac")
+
+	properties, err := taglib.ReadProperties(path)
+	nilErr(t, err)
+	eq(t, len(properties.Images) == 2, true) // have two imaages
+	eq(t, properties.Images[0].Description, "The first image")
+
+	img, err := taglib.ReadImage(path)
+	nilErr(t, err)
 	eq(t, len(img) > 0, true)
 
 	nilErr(t, taglib.WriteImage(path, nil))
@@ -1458,6 +1997,180 @@ func TestFileAllTags(t *testing.T) {
 	}
 }
 
+func TestFileReadAll(t *testing.T) {
+	t.Parallel()
+
+	paths := append(testPaths(t), tmpf(t, egMKATrackTags, "eg_track_tags.mka"), tmpf(t, egWMA, "eg.wma"))
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			f, err := taglib.OpenReadOnly(path)
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+
+			md := f.ReadAll()
+			eq(t, md.Format, f.Format())
+			tagEq(t, md.Tags, f.Tags())
+			tagEq(t, md.Raw, f.RawTags())
+
+			props := f.Properties()
+			eq(t, md.Properties.Length, props.Length)
+			eq(t, md.Properties.Codec, props.Codec)
+			if !slices.Equal(md.Properties.Images, props.Images) {
+				t.Fatalf("%v != %v", md.Properties.Images, props.Images)
+			}
+		})
+	}
+}
+
+func TestReadAll(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egMP3, "eg.mp3")
+	err := taglib.WriteTags(path, map[string][]string{"ARTIST": {"Read All"}}, taglib.Clear)
+	nilErr(t, err)
+
+	md, err := taglib.ReadAll(path)
+	nilErr(t, err)
+	eq(t, md.Format, taglib.FormatMPEG)
+	eq(t, md.Tags["ARTIST"][0], "Read All")
+	eq(t, md.Raw["TPE1"][0], "Read All")
+	if md.Properties.Length == 0 {
+		t.Fatalf("expected length")
+	}
+
+	_, err = taglib.ReadAll(tmpf(t, []byte("not a file"), "eg.flac"))
+	eq(t, err, taglib.ErrInvalidFile)
+}
+
+func TestTagValuesWithSeparators(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			err := taglib.WriteTags(path, map[string][]string{
+				"ARTIST": {"one\ttwo\nthree\n"},
+			}, taglib.Clear)
+			nilErr(t, err)
+
+			tags, err := taglib.ReadTags(path)
+			nilErr(t, err)
+			tagEq(t, tags, map[string][]string{
+				"ARTIST": {"one\ttwo\nthree\n"},
+			})
+		})
+	}
+}
+
+func TestReadBatch(t *testing.T) {
+	t.Parallel()
+
+	dir := t.TempDir()
+	var paths []string
+	for i := 0; i < 3; i++ {
+		path := filepath.Join(dir, fmt.Sprintf("%d.flac", i))
+		err := os.WriteFile(path, egFLAC, os.ModePerm)
+		nilErr(t, err)
+		err = taglib.WriteTags(path, map[string][]string{"TITLE": {fmt.Sprint(i)}}, taglib.Clear)
+		nilErr(t, err)
+		paths = append(paths, path)
+	}
+	invalid := tmpf(t, []byte("not a file"), "eg.flac")
+	paths = []string{paths[0], invalid, paths[1], filepath.Join(dir, "missing.mp3"), paths[2]}
+
+	tagResults := taglib.ReadTagsBatch(paths)
+	eq(t, len(tagResults), len(paths))
+	allResults := taglib.ReadAllBatch(paths)
+	eq(t, len(allResults), len(paths))
+
+	for i, path := range paths {
+		eq(t, tagResults[i].Path, path)
+		eq(t, allResults[i].Path, path)
+
+		tags, err := taglib.ReadTags(path)
+		eq(t, tagResults[i].Err, err)
+		eq(t, allResults[i].Err, err)
+		if err != nil {
+			continue
+		}
+		tagEq(t, tagResults[i].Tags, tags)
+		tagEq(t, allResults[i].Tags, tags)
+	}
+	eq(t, tagResults[1].Err, taglib.ErrInvalidFile)
+	eq(t, tagResults[4].Tags[taglib.Title][0], "2")
+}
+
+func TestScanner(t *testing.T) {
+	t.Parallel()
+
+	dir := t.TempDir()
+	want := map[string]string{}
+	jobs := make(chan taglib.ScanJob)
+	go func() {
+		defer close(jobs)
+		for i := 0; i < 100; i++ {
+			path := filepath.Join(dir, fmt.Sprintf("%d.flac", i))
+			if err := os.WriteFile(path, egFLAC, os.ModePerm); err != nil {
+				panic(err)
+			}
+			if err := taglib.WriteTags(path, map[string][]string{"TITLE": {path}}, taglib.Clear); err != nil {
+				panic(err)
+			}
+			if i%10 == 0 {
+				contents, _ := os.ReadFile(path)
+				jobs <- taglib.ScanJob{Reader: bytes.NewReader(contents), Filename: path}
+				continue
+			}
+			jobs <- taglib.ScanJob{Path: path}
+		}
+		jobs <- taglib.ScanJob{Path: filepath.Join(dir, "missing.flac")}
+	}()
+	for i := 0; i < 100; i++ {
+		path := filepath.Join(dir, fmt.Sprintf("%d.flac", i))
+		want[path] = path
+	}
+
+	var errs int
+	got := map[string]string{}
+	for res := range taglib.NewScanner(taglib.WithWorkers(4)).Scan(jobs) {
+		if res.Err != nil {
+			eq(t, res.Job.Path, filepath.Join(dir, "missing.flac"))
+			errs++
+			continue
+		}
+		name := res.Job.Path
+		if res.Job.Reader != nil {
+			name = res.Job.Filename
+		}
+		got[name] = res.Tags[taglib.Title][0]
+		eq(t, res.Format, taglib.FormatFLAC)
+	}
+	eq(t, errs, 1)
+	if !maps.Equal(got, want) {
+		t.Fatalf("%q != %q", got, want)
+	}
+}
+
+func TestScannerContext(t *testing.T) {
+	t.Parallel()
+
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	path := tmpf(t, egFLAC, "eg.flac")
+	jobs := make(chan taglib.ScanJob, 2)
+	jobs <- taglib.ScanJob{Path: path}
+	jobs <- taglib.ScanJob{Reader: bytes.NewReader(egFLAC), Filename: path}
+	close(jobs)
+
+	var n int
+	for res := range taglib.NewScanner().ScanContext(ctx, jobs) {
+		eq(t, errors.Is(res.Err, context.Canceled), true)
+		n++
+	}
+	eq(t, n, 2)
+}
+
 func TestFileWriteTags(t *testing.T) {
 	t.Parallel()
 
@@ -1499,6 +2212,290 @@ func TestFileImage(t *testing.T) {
 	_ = img
 }
 
+func TestFileImageInto(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egFLAC, "eg.flac")
+	err := taglib.WriteImage(path, coverJPG)
+	nilErr(t, err)
+
+	f, err := taglib.OpenReadOnly(path)
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+
+	size, err := f.ImageSize(0)
+	nilErr(t, err)
+	eq(t, size, len(coverJPG))
+
+	_, err = f.ImageInto(0, make([]byte, size-1))
+	eq(t, err, io.ErrShortBuffer)
+
+	dst := make([]byte, size+10)
+	n, err := f.ImageInto(0, dst)
+	nilErr(t, err)
+	eq(t, n, size)
+	eq(t, bytes.Equal(dst[:n], coverJPG), true)
+
+	var buf bytes.Buffer
+	written, err := f.ImageTo(0, &buf)
+	nilErr(t, err)
+	eq(t, written, int64(size))
+	eq(t, bytes.Equal(buf.Bytes(), coverJPG), true)
+
+	size, err = f.ImageSize(5)
+	nilErr(t, err)
+	eq(t, size, 0)
+	n, err = f.ImageInto(5, dst)
+	nilErr(t, err)
+	eq(t, n, 0)
+}
+
+func TestFileMemoryFlat(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egFLAC, "eg.flac")
+	err := taglib.WriteImage(path, coverJPG)
+	nilErr(t, err)
+
+	f, err := taglib.OpenReadOnly(path)
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+
+	read := func() {
+		_ = f.Tags()
+		_ = f.RawTags()
+		_ = f.Properties()
+		_, err := f.Image(0)
+		nilErr(t, err)
+	}
+	read()
+	before := f.MemoryStats()
+	if before.Size == 0 || before.ResultPeak == 0 {
+		t.Fatalf("expected memory stats, got %+v", before)
+	}
+
+	for i := 0; i < 500; i++ {
+		read()
+	}
+	after := f.MemoryStats()
+	eq(t, after.Size, before.Size)
+	eq(t, after.ResultPeak, before.ResultPeak)
+	eq(t, after.ResultReserved, before.ResultReserved)
+}
+
+func TestFileEdit(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			f, err := taglib.Open(path)
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+
+			_, err = f.Edit().
+				SetTags(map[string][]string{"ARTIST": {"Edit Artist"}}, taglib.Clear).
+				SetImage(coverJPG, 0, "Front Cover", "front", "image/jpeg").
+				SetImage(coverJPG, 1, "Back Cover", "back", "image/jpeg").
+				Apply()
+			nilErr(t, err)
+
+			tagEq(t, f.Tags(), map[string][]string{"ARTIST": {"Edit Artist"}})
+			images := f.Properties().Images
+			if len(images) == 0 {
+				t.Skip("format doesn't store images")
+			}
+			eq(t, len(images), 2)
+			eq(t, images[1].Description, "back")
+
+			_, err = f.Edit().RemoveImage(0).Apply()
+			nilErr(t, err)
+			images = f.Properties().Images
+			eq(t, len(images), 1)
+			eq(t, images[0].Description, "back")
+			tagEq(t, f.Tags(), map[string][]string{"ARTIST": {"Edit Artist"}})
+		})
+	}
+}
+
+func TestWriteUnchanged(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			tags := map[string][]string{"ARTIST": {"Unchanged"}, "ALBUM": {"Same"}}
+			err := taglib.WriteTags(path, tags, taglib.Clear)
+			nilErr(t, err)
+			err = taglib.WriteImageOptions(path, coverJPG, 0, "Front Cover", "", "image/jpeg")
+			nilErr(t, err)
+
+			// Push the modification time back, so a save would be noticed
+			old := time.Now().Add(-time.Hour).Truncate(time.Second)
+			err = os.Chtimes(path, old, old)
+			nilErr(t, err)
+
+			err = taglib.WriteTags(path, tags, 0)
+			nilErr(t, err)
+
+			f, err := taglib.Open(path)
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+
+			edit := f.Edit().SetTags(map[string][]string{"ARTIST": {"Unchanged"}}, 0)
+			if len(f.Properties().Images) > 0 {
+				edit.SetImage(coverJPG, 0, "Front Cover", "", "image/jpeg")
+			}
+			report, err := edit.Apply()
+			nilErr(t, err)
+			eq(t, report.Unchanged, true)
+
+			info, err := os.Stat(path)
+			nilErr(t, err)
+			eq(t, info.ModTime().Equal(old), true)
+
+			report, err = f.Edit().SetTags(map[string][]string{"ARTIST": {"Changed"}}, 0).Apply()
+			nilErr(t, err)
+			eq(t, report.Unchanged, false)
+			eq(t, f.Tags()["ARTIST"][0], "Changed")
+		})
+	}
+}
+
+func TestEditReservePadding(t *testing.T) {
+	t.Parallel()
+
+	for _, tc := range []struct {
+		name string
+		data []byte
+	}{
+		{"eg.mp3", egMP3},
+		{"eg.flac", egFLAC},
+	} {
+		t.Run(tc.name, func(t *testing.T) {
+			path := tmpf(t, tc.data, tc.name)
+			f, err := taglib.Open(path)
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+
+			_, err = f.Edit().
+				SetTags(map[string][]string{"ARTIST": {"Padded"}}, 0).
+				ReservePadding(1000).
+				Apply()
+			nilErr(t, err)
+			eq(t, f.Tags()["ARTIST"][0], "Padded")
+			_, ok := f.Tags()["GOTAGLIB_PADDING"]
+			eq(t, ok, false)
+
+			before, err := os.Stat(path)
+			nilErr(t, err)
+
+			comment := strings.Repeat("x", 500)
+			report, err := f.Edit().SetTags(map[string][]string{"COMMENT": {comment}}, 0).Apply()
+			nilErr(t, err)
+			eq(t, report.InPlace, true)
+			eq(t, f.Tags()["COMMENT"][0], comment)
+
+			after, err := os.Stat(path)
+			nilErr(t, err)
+			eq(t, after.Size(), before.Size())
+		})
+	}
+}
+
+func TestBatchWriter(t *testing.T) {
+	t.Parallel()
+
+	flacPath := tmpf(t, egFLAC, "eg.flac")
+	mp3Path := tmpf(t, egMP3, "eg.mp3")
+	nilErr(t, os.Chmod(flacPath, 0o640))
+	missingPath := filepath.Join(t.TempDir(), "missing.flac")
+
+	setArtist := func(e *taglib.Edit) {
+		e.SetTags(map[string][]string{taglib.Artist: {"Batch"}}, 0).ReservePadding(4096)
+	}
+	w := taglib.NewBatchWriter(taglib.WithWriteWorkers(2), taglib.WithDurability(taglib.DurabilityDirectory))
+	results := w.Write([]taglib.BatchEdit{
+		{Path: flacPath, Edit: setArtist},
+		{Path: mp3Path, Edit: setArtist},
+		{Path: missingPath, Edit: setArtist},
+		{Path: flacPath, Edit: func(e *taglib.Edit) { e.SetImage(coverJPG, 2, "Back Cover", "", "image/jpeg") }},
+	})
+	eq(t, len(results), 3)
+	eq(t, results[0].Path, flacPath)
+	eq(t, results[0].Edits, 2)
+	nilErr(t, results[0].Err)
+	nilErr(t, results[1].Err)
+	eq(t, errors.Is(results[2].Err, os.ErrNotExist), true)
+
+	// The cover grew the file, so it was replaced with a rename
+	eq(t, results[0].InPlace, false)
+	if runtime.GOOS != "windows" {
+		info, err := os.Stat(flacPath)
+		nilErr(t, err)
+		eq(t, info.Mode().Perm(), os.FileMode(0o640))
+	}
+	for _, path := range []string{flacPath, mp3Path} {
+		tags, err := taglib.ReadTags(path)
+		nilErr(t, err)
+		eq(t, tags[taglib.Artist][0], "Batch")
+	}
+	props, err := taglib.ReadProperties(flacPath)
+	nilErr(t, err)
+	eq(t, len(props.Images), 3)
+	entries, err := os.ReadDir(filepath.Dir(flacPath))
+	nilErr(t, err)
+	eq(t, len(entries), 1)
+
+	// A change that fits the padding is still renamed into place when it has to be durable
+	setComment := func(e *taglib.Edit) { e.SetTags(map[string][]string{taglib.Comment: {"Renamed"}}, 0) }
+	results = taglib.NewBatchWriter().Write([]taglib.BatchEdit{{Path: flacPath, Edit: setComment}})
+	nilErr(t, results[0].Err)
+	eq(t, results[0].InPlace, false)
+
+	// and written in place otherwise
+	before, err := os.Stat(flacPath)
+	nilErr(t, err)
+	setComment = func(e *taglib.Edit) { e.SetTags(map[string][]string{taglib.Comment: {"In place"}}, 0) }
+	results = taglib.NewBatchWriter(taglib.WithDurability(taglib.DurabilityNone)).Write([]taglib.BatchEdit{{Path: flacPath, Edit: setComment}})
+	nilErr(t, results[0].Err)
+	eq(t, results[0].InPlace, true)
+	after, err := os.Stat(flacPath)
+	nilErr(t, err)
+	eq(t, after.Size(), before.Size())
+	tags, err := taglib.ReadTags(flacPath)
+	nilErr(t, err)
+	eq(t, tags[taglib.Comment][0], "In place")
+	eq(t, tags[taglib.Artist][0], "Batch")
+
+	results = w.Write([]taglib.BatchEdit{{Path: flacPath, Edit: setComment}})
+	nilErr(t, results[0].Err)
+	eq(t, results[0].Unchanged, true)
+}
+
+func TestFileEditID3v2Frames(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egMP3, "eg.mp3")
+	f, err := taglib.Open(path)
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+
+	_, err = f.Edit().
+		SetID3v2Frames(map[string][]string{"TPE1": {"Frame Artist"}}, 0).
+		SetImage(coverJPG, 0, "Front Cover", "", "image/jpeg").
+		Apply()
+	nilErr(t, err)
+	eq(t, f.RawTags()["TPE1"][0], "Frame Artist")
+	eq(t, len(f.Properties().Images), 1)
+
+	f, err = taglib.Open(tmpf(t, egFLAC, "eg.flac"))
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+	_, err = f.Edit().SetID3v2Frames(map[string][]string{"TPE1": {"Frame Artist"}}, 0).Apply()
+	eq(t, err, taglib.ErrSavingFile)
+}
+
 func TestFileEfficiency(t *testing.T) {
 	// This test verifies that File handle API is more efficient
 	// by only creating one WASM module for multiple operations
@@ -1689,3 +2686,373 @@ func TestFileFormatString(t *testing.T) {
 		eq(t, tt.format.String(), tt.want)
 	}
 }
+
+func TestDetectFormat(t *testing.T) {
+	t.Parallel()
+
+	tests := []struct {
+		name string
+		data []byte
+		want taglib.FileFormat
+	}{
+		{"eg.flac", egFLAC, taglib.FormatFLAC},
+		{"eg.mp3", egMP3, taglib.FormatMPEG},
+		{"eg.m4a", egM4a, taglib.FormatMP4},
+		{"eg.wav", egWAV, taglib.FormatWAV},
+		{"eg.ogg", egOgg, taglib.FormatOggVorbis},
+		{"eg.opus", egOpus, taglib.FormatOggOpus},
+		{"eg.aiff", egAIFF, taglib.FormatAIFF},
+		{"eg.wma", egWMA, taglib.FormatASF},
+		{"eg.mka", egMKA, taglib.FormatMatroska},
+		{"eg.txt", []byte("not an audio file"), taglib.FormatUnknown},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			// Detection only looks at the content, so the wrong extension doesn't matter
+			path := tmpf(t, tt.data, "file.bin")
+			format, err := taglib.DetectFormat(path)
+			nilErr(t, err)
+			eq(t, format, tt.want)
+
+			format, err = taglib.DetectFormatReader(bytes.NewReader(tt.data))
+			nilErr(t, err)
+			eq(t, format, tt.want)
+
+			if tt.want == taglib.FormatUnknown {
+				return
+			}
+			f, err := taglib.Open(path, taglib.WithFormat(format))
+			nilErr(t, err)
+			eq(t, f.Format(), tt.want)
+			_ = f.Close()
+
+			// Streams without a filename are sniffed before TagLib sees them
+			f, err = taglib.OpenStream(bytes.NewReader(tt.data))
+			nilErr(t, err)
+			eq(t, f.Format(), tt.want)
+			_ = f.Close()
+		})
+	}
+
+	// A wrong hint falls back to TagLib's own detection
+	f, err := taglib.Open(tmpf(t, egFLAC, "eg.flac"), taglib.WithFormat(taglib.FormatMP4))
+	nilErr(t, err)
+	defer func() { _ = f.Close() }()
+	eq(t, f.Format(), taglib.FormatFLAC)
+
+	_, err = taglib.DetectFormat(filepath.Join(t.TempDir(), "missing.mp3"))
+	eq(t, errors.Is(err, os.ErrNotExist), true)
+}
+
+func TestPrecompile(t *testing.T) {
+	t.Parallel()
+
+	dir := t.TempDir()
+	nilErr(t, taglib.Precompile(dir))
+
+	entries, err := os.ReadDir(dir)
+	nilErr(t, err)
+	eq(t, len(entries) > 0, true)
+
+	// Compiling again loads what's already in the cache
+	nilErr(t, taglib.Precompile(dir))
+}
+
+func TestTagsFor(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			err := taglib.WriteTags(path, map[string][]string{
+				taglib.Artist: {"Artist"},
+				taglib.Title:  {"Title"},
+				taglib.Lyrics: {strings.Repeat("la ", 10000)},
+			}, 0)
+			nilErr(t, err)
+
+			all, err := taglib.ReadTags(path)
+			nilErr(t, err)
+			want := map[string][]string{}
+			for _, k := range []string{taglib.Artist, taglib.Title, taglib.Genre} {
+				if v, ok := all[k]; ok {
+					want[k] = v
+				}
+			}
+
+			// Keys match case-insensitively, and ones the file doesn't have are left out
+			keys := []string{"artist", taglib.Title, taglib.Genre, "NOT_A_TAG", taglib.Title}
+
+			f, err := taglib.Open(path)
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+			tagEq(t, f.TagsFor(keys...), want)
+			eq(t, len(f.TagsFor()), 0)
+
+			tags, err := taglib.ReadTagsKeys(path, keys)
+			nilErr(t, err)
+			tagEq(t, tags, want)
+		})
+	}
+
+	_, err := taglib.ReadTagsKeys(tmpf(t, []byte("not a file"), "eg.mp3"), []string{taglib.Title})
+	eq(t, err, taglib.ErrInvalidFile)
+}
+
+func TestHandleReuse(t *testing.T) {
+	t.Parallel()
+
+	pathMP3 := tmpf(t, egMP3, "eg.mp3")
+	pathFLAC := tmpf(t, egFLAC, "eg.flac")
+	tagsMP3, err := taglib.ReadTags(pathMP3)
+	nilErr(t, err)
+	tagsFLAC, err := taglib.ReadTags(pathFLAC)
+	nilErr(t, err)
+
+	// Pooled modules hand out the slots of closed handles again, each open must still see
+	// only its own file
+	for i := 0; i < 50; i++ {
+		a, err := taglib.Open(pathMP3)
+		nilErr(t, err)
+		b, err := taglib.OpenStream(bytes.NewReader(egFLAC), taglib.WithFilename(pathFLAC))
+		nilErr(t, err)
+		tagEq(t, a.Tags(), tagsMP3)
+		tagEq(t, b.Tags(), tagsFLAC)
+		nilErr(t, a.Close())
+		nilErr(t, b.Close())
+	}
+}
+
+func TestTagFingerprint(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			fp, err := taglib.TagFingerprint(path)
+			nilErr(t, err)
+			format, err := taglib.DetectFormat(path)
+			nilErr(t, err)
+			if format == taglib.FormatMatroska {
+				eq(t, fp, uint64(0)) // tag regions aren't known
+				return
+			}
+			eq(t, fp != 0, true)
+
+			f, err := taglib.Open(path)
+			nilErr(t, err)
+			eq(t, f.TagFingerprint(), fp)
+			nilErr(t, f.Close())
+
+			data, err := os.ReadFile(path)
+			nilErr(t, err)
+			s, err := taglib.OpenReaderAt(bytes.NewReader(data), int64(len(data)), taglib.WithFilename(path))
+			nilErr(t, err)
+			eq(t, s.TagFingerprint(), fp)
+			nilErr(t, s.Close())
+
+			// Touching the file doesn't change it, editing the tags does
+			now := time.Now()
+			nilErr(t, os.Chtimes(path, now, now))
+			touched, err := taglib.TagFingerprint(path)
+			nilErr(t, err)
+			eq(t, touched, fp)
+
+			nilErr(t, taglib.WriteTags(path, map[string][]string{"ARTIST": {"Fingerprinted"}}, 0))
+			edited, err := taglib.TagFingerprint(path)
+			nilErr(t, err)
+			eq(t, edited != fp, true)
+		})
+	}
+}
+
+func TestTagFingerprintOggContinuation(t *testing.T) {
+	t.Parallel()
+
+	// The comment packet spans several pages, and the change lands in one that no packet
+	// ends on, so its granule position is -1
+	path := tmpf(t, egOgg, "eg.ogg")
+	cover := make([]byte, 200*1024)
+	copy(cover, "\xff\xd8\xff")
+	nilErr(t, taglib.WriteImage(path, cover))
+	before, err := taglib.TagFingerprint(path)
+	nilErr(t, err)
+
+	cover[70*1024] = 1
+	nilErr(t, taglib.WriteImage(path, cover))
+	after, err := taglib.TagFingerprint(path)
+	nilErr(t, err)
+	eq(t, after != before, true)
+}
+
+func TestCache(t *testing.T) {
+	t.Parallel()
+
+	dir := t.TempDir()
+	path := tmpf(t, egFLAC, "eg.flac")
+	logPath := filepath.Join(dir, "cache.log")
+	logSize := func() int64 {
+		info, err := os.Stat(logPath)
+		nilErr(t, err)
+		return info.Size()
+	}
+
+	c, err := taglib.OpenCache(logPath)
+	nilErr(t, err)
+
+	want, err := taglib.ReadAll(path)
+	nilErr(t, err)
+	md, err := c.ReadAll(path)
+	nilErr(t, err)
+	tagEq(t, md.Tags, want.Tags)
+	eq(t, md.Properties.Length, want.Properties.Length)
+
+	// Unchanged files are served from the cache without adding to the log
+	size := logSize()
+	md, err = c.ReadAll(path)
+	nilErr(t, err)
+	tagEq(t, md.Tags, want.Tags)
+	eq(t, logSize(), size)
+
+	// A touched file is recognized by its fingerprint, and only its new time is recorded
+	later := time.Now().Add(time.Minute)
+	nilErr(t, os.Chtimes(path, later, later))
+	md, err = c.ReadAll(path)
+	nilErr(t, err)
+	tagEq(t, md.Tags, want.Tags)
+	eq(t, logSize() > size, true)
+
+	nilErr(t, taglib.WriteTags(path, map[string][]string{"ARTIST": {"Cached"}}, 0))
+	md, err = c.ReadAll(path)
+	nilErr(t, err)
+	eq(t, md.Tags["ARTIST"][0], "Cached")
+	nilErr(t, c.Close())
+
+	// A torn record at the end of the log is dropped when it's opened again
+	log, err := os.OpenFile(logPath, os.O_APPEND|os.O_WRONLY, 0)
+	nilErr(t, err)
+	_, err = log.WriteString(`{"path":"/torn`)
+	nilErr(t, err)
+	nilErr(t, log.Close())
+
+	c, err = taglib.OpenCache(logPath)
+	nilErr(t, err)
+	defer func() { _ = c.Close() }()
+	size = logSize()
+	md, err = c.ReadAll(path)
+	nilErr(t, err)
+	eq(t, md.Tags["ARTIST"][0], "Cached")
+	eq(t, logSize(), size)
+
+	// Compacting keeps one record per file
+	nilErr(t, c.Compact())
+	eq(t, logSize() < size, true)
+	md, err = c.ReadAll(path)
+	nilErr(t, err)
+	eq(t, md.Tags["ARTIST"][0], "Cached")
+
+	_, err = c.ReadAll(filepath.Join(dir, "missing.flac"))
+	eq(t, errors.Is(err, os.ErrNotExist), true)
+}
+
+func TestCacheAudioEdit(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egMP3, "eg.mp3")
+	c, err := taglib.OpenCache(filepath.Join(t.TempDir(), "cache.log"))
+	nilErr(t, err)
+	defer func() { _ = c.Close() }()
+
+	before, err := c.ReadAll(path)
+	nilErr(t, err)
+
+	// Doubling the frame count of the Info header changes the length, but not the size or
+	// the tags
+	data, err := os.ReadFile(path)
+	nilErr(t, err)
+	info := bytes.Index(data, []byte("Info"))
+	eq(t, info > 0, true)
+	frames := binary.BigEndian.Uint32(data[info+8:])
+	binary.BigEndian.PutUint32(data[info+8:], frames*2)
+	nilErr(t, os.WriteFile(path, data, 0o644))
+	later := time.Now().Add(time.Minute)
+	nilErr(t, os.Chtimes(path, later, later))
+
+	want, err := taglib.ReadProperties(path)
+	nilErr(t, err)
+	eq(t, want.Length != before.Properties.Length, true)
+	after, err := c.ReadAll(path)
+	nilErr(t, err)
+	tagEq(t, after.Tags, before.Tags)
+	eq(t, after.Properties.Length, want.Length)
+}
+
+func TestCacheDamagedRecord(t *testing.T) {
+	t.Parallel()
+
+	path := tmpf(t, egFLAC, "eg.flac")
+	logPath := filepath.Join(t.TempDir(), "cache.log")
+
+	c, err := taglib.OpenCache(logPath)
+	nilErr(t, err)
+	_, err = c.ReadAll(path)
+	nilErr(t, err)
+	nilErr(t, c.Close())
+	record, err := os.ReadFile(logPath)
+	nilErr(t, err)
+
+	// A damaged line before the record doesn't lose it
+	nilErr(t, os.WriteFile(logPath, append([]byte("{\"path\":\n"), record...), 0o644))
+	c, err = taglib.OpenCache(logPath)
+	nilErr(t, err)
+	defer func() { _ = c.Close() }()
+	_, err = c.ReadAll(path)
+	nilErr(t, err)
+	log, err := os.ReadFile(logPath)
+	nilErr(t, err)
+	eq(t, len(log), len(record)+len("{\"path\":\n"))
+
+	// Compacting drops it
+	nilErr(t, c.Compact())
+	log, err = os.ReadFile(logPath)
+	nilErr(t, err)
+	eq(t, string(log), string(record))
+}
+
+func TestVisitTags(t *testing.T) {
+	t.Parallel()
+
+	paths := testPaths(t)
+	for _, path := range paths {
+		t.Run(filepath.Base(path), func(t *testing.T) {
+			err := taglib.WriteTags(path, map[string][]string{
+				taglib.Artist: {"Artist 1", "Artist 2"},
+				taglib.Title:  {"Title"},
+			}, 0)
+			nilErr(t, err)
+
+			f, err := taglib.Open(path)
+			nilErr(t, err)
+			defer func() { _ = f.Close() }()
+
+			visited := map[string][]string{}
+			nilErr(t, f.VisitTags(func(key, value []byte) bool {
+				k := taglib.InternKey(key)
+				visited[k] = append(visited[k], string(value))
+				return true
+			}))
+			tagEq(t, visited, f.Tags())
+
+			// Returning false stops the walk
+			var n int
+			nilErr(t, f.VisitTags(func(key, value []byte) bool {
+				n++
+				return false
+			}))
+			eq(t, n, 1)
+		})
+	}
+
+	eq(t, taglib.InternKey([]byte("TITLE")), taglib.Title)
+	eq(t, taglib.InternKey([]byte("NOT_A_KEY")), "NOT_A_KEY")
+}
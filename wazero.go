@@ -0,0 +1,281 @@
+//go:build !taglib_native
+
+package taglib
+
+import (
+	"context"
+	_ "embed"
+	"fmt"
+	"os"
+	"sync"
+
+	"github.com/tetratelabs/wazero"
+	"github.com/tetratelabs/wazero/api"
+	"github.com/tetratelabs/wazero/imports/wasi_snapshot_preview1"
+)
+
+//go:embed taglib.wasm
+var binary []byte // WASM blob. To override, go build -ldflags="-X 'go.senan.xyz/taglib.binaryPath=/path/to/taglib.wasm'"
+var binaryPath string
+
+// binarySIMDPath is a build of the module with Wasm SIMD, see build/build.sh. If it's set
+// with -ldflags="-X 'go.senan.xyz/taglib.binarySIMDPath=/path/to/taglib_simd.wasm'", it's
+// used instead of the scalar binary when the runtime can run SIMD code.
+var binarySIMDPath string
+
+type rc struct {
+	wazero.Runtime
+	wazero.CompiledModule
+}
+
+// instanceMemory is true as each instance has a memory of its own
+const instanceMemory = true
+
+var getRuntimeOnce = sync.OnceValues(func() (rc, error) {
+	c := getConfig()
+	return newRuntime(context.Background(), c.cacheDir, c.memoryLimitPages)
+})
+
+func precompile(dir string) error {
+	ctx := context.Background()
+	r, err := newRuntime(ctx, dir, 0)
+	if err != nil {
+		return err
+	}
+	return r.Runtime.Close(ctx)
+}
+
+// newRuntime creates a runtime with the host modules and compiles the module, using the
+// compilation cache in cacheDir unless it's empty. Instances can't grow their memory past
+// memoryLimitPages, unless it's 0.
+func newRuntime(ctx context.Context, cacheDir string, memoryLimitPages uint32) (rc, error) {
+	// Calls given a context that ends are stopped, see module.callContext
+	runtimeConfig := wazero.NewRuntimeConfig().WithCloseOnContextDone(true)
+	if memoryLimitPages > 0 {
+		runtimeConfig = runtimeConfig.WithMemoryLimitPages(memoryLimitPages)
+	}
+	if cacheDir != "" {
+		compilationCache, err := wazero.NewCompilationCacheWithDir(cacheDir)
+		if err != nil {
+			return rc{}, err
+		}
+		runtimeConfig = runtimeConfig.WithCompilationCache(compilationCache)
+	}
+
+	rt := wazero.NewRuntimeWithConfig(ctx, runtimeConfig)
+	wasi_snapshot_preview1.MustInstantiate(ctx, rt)
+
+	_, err := rt.
+		NewHostModuleBuilder("env").
+		NewFunctionBuilder().WithFunc(func(int32) int32 { panic("__cxa_allocate_exception") }).Export("__cxa_allocate_exception").
+		NewFunctionBuilder().WithFunc(func(int32, int32, int32) { panic("__cxa_throw") }).Export("__cxa_throw").
+		Instantiate(ctx)
+	if err != nil {
+		return rc{}, err
+	}
+
+	// Register stream I/O host functions for OpenStream support
+	_, err = rt.
+		NewHostModuleBuilder("go_io").
+		NewFunctionBuilder().WithFunc(wasmStreamRead).Export("stream_read").
+		NewFunctionBuilder().WithFunc(hostStreamSeek).Export("stream_seek").
+		NewFunctionBuilder().WithFunc(hostStreamTell).Export("stream_tell").
+		NewFunctionBuilder().WithFunc(hostStreamLength).Export("stream_length").
+		NewFunctionBuilder().WithFunc(wasmStreamPread).Export("stream_pread").
+		NewFunctionBuilder().WithFunc(wasmStreamPwrite).Export("stream_pwrite").
+		NewFunctionBuilder().WithFunc(hostStreamTruncate).Export("stream_truncate").
+		NewFunctionBuilder().WithFunc(wasmMemoryExhausted).Export("memory_exhausted").
+		Instantiate(ctx)
+	if err != nil {
+		return rc{}, err
+	}
+
+	var bin = binary
+	if binaryPath != "" {
+		bin, err = os.ReadFile(binaryPath)
+		if err != nil {
+			return rc{}, fmt.Errorf("read custom binary path: %w", err)
+		}
+		clear(binary)
+	}
+
+	// Prefer the SIMD build if one is given and the runtime supports SIMD
+	if binarySIMDPath != "" && simdSupported(ctx, rt) {
+		bin, err = os.ReadFile(binarySIMDPath)
+		if err != nil {
+			return rc{}, fmt.Errorf("read custom SIMD binary path: %w", err)
+		}
+		clear(binary)
+	}
+
+	compiled, err := rt.CompileModule(ctx, bin)
+	if err != nil {
+		return rc{}, err
+	}
+	if err := checkExports(compiled); err != nil {
+		return rc{}, err
+	}
+
+	return rc{
+		Runtime:        rt,
+		CompiledModule: compiled,
+	}, nil
+}
+
+// simdProbe is a module exporting probe, which returns lane 3 of an i32x4.splat of 7
+var simdProbe = []byte{
+	0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, // magic, version
+	0x01, 0x05, 0x01, 0x60, 0x00, 0x01, 0x7f, // type: () -> i32
+	0x03, 0x02, 0x01, 0x00, // function 0 of type 0
+	0x07, 0x09, 0x01, 0x05, 'p', 'r', 'o', 'b', 'e', 0x00, 0x00, // export function 0 as probe
+	0x0a, 0x0b, 0x01, 0x09, 0x00, // code, one body without locals
+	0x41, 0x07, // i32.const 7
+	0xfd, 0x11, // i32x4.splat
+	0xfd, 0x1b, 0x03, // i32x4.extract_lane 3
+	0x0b, // end
+}
+
+// simdSupported reports whether rt runs Wasm SIMD, by running simdProbe. The runtime's
+// features can't be queried, and a module that validates could still fail to run.
+func simdSupported(ctx context.Context, rt wazero.Runtime) bool {
+	mod, err := rt.Instantiate(ctx, simdProbe)
+	if err != nil {
+		return false
+	}
+	defer func() { _ = mod.Close(ctx) }()
+	fn := mod.ExportedFunction("probe")
+	if fn == nil {
+		return false
+	}
+	res, err := fn.Call(ctx)
+	return err == nil && len(res) == 1 && uint32(res[0]) == 7
+}
+
+// moduleExports are the functions of the module that the package calls
+var moduleExports = []string{
+	"malloc",
+	"taglib_version",
+	"taglib_reset",
+	"taglib_arena_stats",
+	"taglib_file_open",
+	"taglib_file_close",
+	"taglib_stream_open",
+	"taglib_stream_open_reader_at",
+	"taglib_handle_stream_stats",
+	"taglib_handle_tags",
+	"taglib_handle_tags_keys",
+	"taglib_handle_raw_tags",
+	"taglib_handle_properties",
+	"taglib_handle_read_all",
+	"taglib_handle_image",
+	"taglib_handle_image_size",
+	"taglib_handle_write_tags",
+	"taglib_handle_write_image",
+	"taglib_handle_tag_fingerprint",
+	"taglib_handle_apply",
+	"taglib_file_tags",
+	"taglib_file_tags_keys",
+	"taglib_file_read_all",
+	"taglib_file_tags_batch",
+	"taglib_file_read_all_batch",
+	"taglib_file_write_tags",
+	"taglib_file_read_properties",
+	"taglib_file_read_image",
+	"taglib_file_write_image",
+	"taglib_file_id3v2_frames",
+	"taglib_file_id3v1_tags",
+	"taglib_file_mp4_atoms",
+	"taglib_file_asf_attributes",
+	"taglib_file_tag_fingerprint",
+	"taglib_file_write_id3v2_frames",
+}
+
+// checkExports makes sure compiled has every function the package calls, so a binary built
+// from an older taglib.cpp fails to load rather than on the first call it lacks
+func checkExports(compiled wazero.CompiledModule) error {
+	exported := compiled.ExportedFunctions()
+	for _, name := range moduleExports {
+		if _, ok := exported[name]; !ok {
+			return fmt.Errorf("module has no export %q, rebuild it from this version of taglib.cpp", name)
+		}
+	}
+	return nil
+}
+
+// Stream I/O imports of the module. Buffers are handed to the host functions through the
+// writable view of memory that api.Memory.Read returns, and ctx is the one of the call.
+func wasmStreamRead(ctx context.Context, m api.Module, streamId, bufPtr, length uint32) uint32 {
+	buf, ok := m.Memory().Read(bufPtr, length)
+	if !ok {
+		return 0
+	}
+	return hostStreamRead(ctx, streamId, buf)
+}
+
+func wasmStreamPread(ctx context.Context, m api.Module, streamId uint32, offset int64, bufPtr, length uint32) uint32 {
+	buf, ok := m.Memory().Read(bufPtr, length)
+	if !ok {
+		return 0
+	}
+	return hostStreamPread(ctx, streamId, offset, buf)
+}
+
+func wasmStreamPwrite(_ context.Context, m api.Module, streamId uint32, offset int64, bufPtr, length uint32) uint32 {
+	buf, ok := m.Memory().Read(bufPtr, length)
+	if !ok {
+		return 0
+	}
+	return hostStreamPwrite(streamId, offset, buf)
+}
+
+func wasmMemoryExhausted(ctx context.Context, size uint32) {
+	hostMemoryExhausted(ctx)
+}
+
+// wasmInstance is an instance of the compiled module, with only root mounted into its
+// filesystem, or nothing if root is empty.
+type wasmInstance struct {
+	mod api.Module
+}
+
+// newInstance instantiates the module with root mounted at its own path. Read-only pools
+// mount it through lease, writable modules mount the directory itself.
+func newInstance(root string, readOnly bool, lease *leaseFS) (instance, error) {
+	rt, err := getRuntimeOnce()
+	if err != nil {
+		return nil, fmt.Errorf("get runtime once: %w", err)
+	}
+
+	cfg := wazero.
+		NewModuleConfig().
+		WithName("").
+		WithStartFunctions("_initialize")
+
+	if root != "" {
+		fsConfig := wazero.NewFSConfig()
+		if lease != nil {
+			fsConfig = fsConfig.WithFSMount(lease, wasmPath(root))
+		} else {
+			fsConfig = fsConfig.WithDirMount(root, wasmPath(root))
+		}
+		cfg = cfg.WithFSConfig(fsConfig)
+	}
+
+	mod, err := rt.InstantiateModule(context.Background(), rt.CompiledModule, cfg)
+	if err != nil {
+		return nil, err
+	}
+	return wasmInstance{mod}, nil
+}
+
+func (i wasmInstance) memory() memory { return i.mod.Memory() }
+
+func (i wasmInstance) call(ctx context.Context, name string, params ...uint64) ([]uint64, error) {
+	fn := i.mod.ExportedFunction(name)
+	if fn == nil {
+		return nil, fmt.Errorf("no export %q", name)
+	}
+	return fn.Call(ctx, params...)
+}
+
+func (i wasmInstance) close() error { return i.mod.Close(context.Background()) }